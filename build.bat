@@ -1,13 +1,16 @@
 @echo off
 
 IF NOT EXIST "build" mkdir build
+IF NOT EXIST "build\headless" mkdir build\headless
 
 SET path_to_stbtt=""
 
-SET sources="source/thermal.cpp" "source/utf.cpp" "source/io.cpp" "source/font.cpp" "source/renderer.cpp" "source/ui.cpp" "source/ansi_escape_parser.cpp" "source/win32_platform.cpp"
-SET linker="/SUBSYSTEM:CONSOLE" "/INCREMENTAL:NO" "User32.lib" "Ole32.lib" "Shell32.lib" "Shlwapi.lib" "Gdi32.lib" "Opengl32.lib" "Dbghelp.lib" "Onecore.lib"
+SET sources="source/thermal.cpp" "source/console.cpp" "source/utf.cpp" "source/io.cpp" "source/font.cpp" "source/renderer.cpp" "source/ui.cpp" "source/ansi_escape_parser.cpp" "source/pipe_reader.cpp" "source/win32_platform.cpp"
+SET headless_sources="source/headless.cpp" "source/benchmark.cpp" "source/console.cpp" "source/font.cpp" "source/utf.cpp" "source/io.cpp" "source/ansi_escape_parser.cpp" "source/pipe_reader.cpp" "source/win32_platform.cpp"
+SET linker="/SUBSYSTEM:CONSOLE" "/INCREMENTAL:NO" "User32.lib" "Ole32.lib" "Shell32.lib" "Shlwapi.lib" "Gdi32.lib" "Opengl32.lib" "Dbghelp.lib" "Onecore.lib" "Psapi.lib"
 
 cl /D"DEVELOPER" /D"BOUNDS_CHECKING" /Isource /I"%path_to_stbtt%" /FC /Zi /nologo /W2 /permissive- /Fo"build/debug/" /Fd"build/debug/" /Fe"build/debug/thermal.exe" %sources% /link %linker%
+cl /O2 /D"HEADLESS" /Isource /I"%path_to_stbtt%" /FC /Zi /nologo /W2 /permissive- /Fo"build/headless/" /Fd"build/headless/" /Fe"build/debug/thermal_headless.exe" %headless_sources% /link %linker%
 
 IF NOT EXIST "build\debug\data" mkdir build\debug\data
 xcopy /eyq "data" "build\debug\data"
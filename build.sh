@@ -0,0 +1,17 @@
+#!/bin/sh
+
+mkdir -p build/debug
+
+path_to_stbtt="${path_to_stbtt:-}"
+
+sources="source/thermal.cpp source/console.cpp source/utf.cpp source/io.cpp source/font.cpp source/renderer.cpp source/ui.cpp source/ansi_escape_parser.cpp source/pipe_reader.cpp source/linux_platform.cpp"
+linker="-rdynamic -lX11 -lGL -lpthread -lutil"
+
+headless_sources="source/headless.cpp source/benchmark.cpp source/console.cpp source/font.cpp source/utf.cpp source/io.cpp source/ansi_escape_parser.cpp source/pipe_reader.cpp source/linux_platform.cpp"
+headless_linker="-rdynamic -lpthread -lutil"
+
+g++ -std=c++17 -D"DEVELOPER" -D"BOUNDS_CHECKING" -Isource -I"$path_to_stbtt" -g -o build/debug/thermal $sources $linker || exit 1
+g++ -std=c++17 -O2 -D"HEADLESS" -Isource -I"$path_to_stbtt" -g -o build/debug/thermal_headless $headless_sources $headless_linker || exit 1
+
+mkdir -p build/debug/data
+cp -r data/. build/debug/data
@@ -1,9 +1,14 @@
 #if defined(VERTEX_SHADER_PART)
 
-layout (location = 0) in vec3 pos;
-layout (location = 2) in vec2 uv;
-layout (location = 3) in vec4 fg_in;
-layout (location = 4) in vec4 bg_in;
+// Every cell is drawn as two triangles. The cell index and the corner come from gl_VertexID,
+// the cell itself from the cell buffer (UITextCell in ui.h):
+//     x: position x | position y << 16
+//     y: atlas x    | atlas y    << 16, bit 15 is set for glyphs drawn over the next cell as well
+//     z: foreground color
+//     w: background color
+uniform usamplerBuffer cells;
+uniform sampler2D image;
+uniform vec2 cell_size;
 
 out vec2 uv_vs;
 out vec4 fg_vs;
@@ -15,12 +20,31 @@ layout (std140) uniform Matrices {
     mat4 view;
 };
 
+const vec2 corners[6] = vec2[6](
+    vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(0.0, 1.0),
+    vec2(0.0, 1.0), vec2(1.0, 0.0), vec2(1.0, 1.0)
+);
+
+vec2 unpack_position(uint value) {
+    return vec2(float(value & 0xFFFFu), float(value >> 16));
+}
+
+vec4 unpack_color(uint value) {
+    return vec4(float(value & 0xFFu), float((value >> 8) & 0xFFu), float((value >> 16) & 0xFFu), float(value >> 24)) / 255.0;
+}
+
 void main() {
-    gl_Position = proj2D * vec4(pos, 1.0);
+    // NOTE: Wide glyphs are only flagged when the next cell is the spacer of a wide character,
+    //       which draws nothing itself. So they never overlap the text of another cell.
+    uvec4 cell  = texelFetch(cells, gl_VertexID / 6);
+    float width = (cell.y & 0x8000u) != 0u ? 2.0 : 1.0;
+    vec2 corner = corners[gl_VertexID % 6] * vec2(width, 1.0) * cell_size;
 
-    uv_vs = uv;
-    fg_vs = fg_in;
-    bg_vs = bg_in;
+    gl_Position = proj2D * vec4(unpack_position(cell.x) + corner, 0.0, 1.0);
+
+    uv_vs = (unpack_position(cell.y & 0xFFFF7FFFu) + corner) / vec2(textureSize(image, 0));
+    fg_vs = unpack_color(cell.z);
+    bg_vs = unpack_color(cell.w);
 }
 
 #endif // defined(VERTEX_SHADER_PART)
@@ -44,4 +68,3 @@ void main() {
 }
 
 #endif // defined(FRAGMENT_SHADER_PART)
-
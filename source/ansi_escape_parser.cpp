@@ -95,73 +95,339 @@ INTERNAL ANSIColorTable const DefaultColors = {
 INTERNAL ANSIColorTable ColorPalette = DefaultColors;
 
 
-// TODO: Harden the parser to reject incomplete or invalid/unknown paths.
-EscapeSequence parse_escape_sequence(String str) {
-    EscapeSequence seq = {};
-
-    s64 index = 0;
-    if (index < str.size && str[index] == 0x1B) {
-        index += 1;
-
-        if (index < str.size && str[index] == '[') {
-            index += 1;
-
-            String arg = {str.data + index, 0};
-            while (index < str.size) {
-                if (str[index] >= '0' && str[index] <= '9') {
-                    arg.size += 1;
-                } else if (str[index] == ';') {
-                    s64 num = 0;
-                    if (arg.size) {
-                        num = convert_string_to_s64(arg.data, arg.size);
-                    }
-
-                    if (seq.arg_count == EscapeSequenceMaxArgs) {
-                        LOG(LOG_ERROR, "Escape sequence has too many arguments.");
-                        return {};
-                    }
-
-                    seq.args[seq.arg_count] = num;
-                    seq.arg_count += 1;
-
-                    arg = {str.data + index + 1, 0};
-                } else {
-                    s64 num = 0;
-                    if (arg.size) {
-                        num = convert_string_to_s64(arg.data, arg.size);
-                    }
-
-                    if (seq.arg_count == EscapeSequenceMaxArgs) {
-                        LOG(LOG_ERROR, "Escape sequence has too many arguments.");
-                        return {};
-                    }
-
-                    seq.args[seq.arg_count] = num;
-                    seq.arg_count += 1;
-
-                    break;
-                }
-
-                index += 1;
-            }
+enum ANSIParserAction {
+    ANSI_ACTION_NONE,
+    ANSI_ACTION_IGNORE,
+    ANSI_ACTION_PRINT,
+    ANSI_ACTION_EXECUTE,
+    ANSI_ACTION_CLEAR,
+    ANSI_ACTION_COLLECT,
+    ANSI_ACTION_PARAM,
+    ANSI_ACTION_ESC_DISPATCH,
+    ANSI_ACTION_CSI_DISPATCH,
+    ANSI_ACTION_HOOK,
+    ANSI_ACTION_PUT,
+    ANSI_ACTION_UNHOOK,
+    ANSI_ACTION_OSC_START,
+    ANSI_ACTION_OSC_PUT,
+    ANSI_ACTION_OSC_END,
+};
+
+// Each entry packs the action into the high and the next state into the low nibble.
+INTERNAL u8  TransitionTable[ANSI_STATE_COUNT][256];
+INTERNAL b32 TransitionTableInitialized;
+
+INTERNAL u8 const EntryActions[ANSI_STATE_COUNT] = {
+    ANSI_ACTION_NONE,      // ANSI_STATE_GROUND
+    ANSI_ACTION_CLEAR,     // ANSI_STATE_ESCAPE
+    ANSI_ACTION_NONE,      // ANSI_STATE_ESCAPE_INTERMEDIATE
+    ANSI_ACTION_CLEAR,     // ANSI_STATE_CSI_ENTRY
+    ANSI_ACTION_NONE,      // ANSI_STATE_CSI_PARAM
+    ANSI_ACTION_NONE,      // ANSI_STATE_CSI_INTERMEDIATE
+    ANSI_ACTION_NONE,      // ANSI_STATE_CSI_IGNORE
+    ANSI_ACTION_CLEAR,     // ANSI_STATE_DCS_ENTRY
+    ANSI_ACTION_NONE,      // ANSI_STATE_DCS_PARAM
+    ANSI_ACTION_NONE,      // ANSI_STATE_DCS_INTERMEDIATE
+    ANSI_ACTION_HOOK,      // ANSI_STATE_DCS_PASSTHROUGH
+    ANSI_ACTION_NONE,      // ANSI_STATE_DCS_IGNORE
+    ANSI_ACTION_OSC_START, // ANSI_STATE_OSC_STRING
+    ANSI_ACTION_NONE,      // ANSI_STATE_SOS_PM_APC_STRING
+};
+
+INTERNAL u8 const ExitActions[ANSI_STATE_COUNT] = {
+    ANSI_ACTION_NONE,    // ANSI_STATE_GROUND
+    ANSI_ACTION_NONE,    // ANSI_STATE_ESCAPE
+    ANSI_ACTION_NONE,    // ANSI_STATE_ESCAPE_INTERMEDIATE
+    ANSI_ACTION_NONE,    // ANSI_STATE_CSI_ENTRY
+    ANSI_ACTION_NONE,    // ANSI_STATE_CSI_PARAM
+    ANSI_ACTION_NONE,    // ANSI_STATE_CSI_INTERMEDIATE
+    ANSI_ACTION_NONE,    // ANSI_STATE_CSI_IGNORE
+    ANSI_ACTION_NONE,    // ANSI_STATE_DCS_ENTRY
+    ANSI_ACTION_NONE,    // ANSI_STATE_DCS_PARAM
+    ANSI_ACTION_NONE,    // ANSI_STATE_DCS_INTERMEDIATE
+    ANSI_ACTION_UNHOOK,  // ANSI_STATE_DCS_PASSTHROUGH
+    ANSI_ACTION_NONE,    // ANSI_STATE_DCS_IGNORE
+    ANSI_ACTION_OSC_END, // ANSI_STATE_OSC_STRING
+    ANSI_ACTION_NONE,    // ANSI_STATE_SOS_PM_APC_STRING
+};
+
+INTERNAL void set_transition(u32 state, u32 first, u32 last, u32 action, u32 next) {
+    for (u32 c = first; c <= last; c += 1) {
+        TransitionTable[state][c] = (u8)((action << 4) | next);
+    }
+}
+
+// Sets the transition for all C0 controls except the ones handled the same in every state.
+INTERNAL void set_c0_transition(u32 state, u32 action, u32 next) {
+    set_transition(state, 0x00, 0x17, action, next);
+    set_transition(state, 0x19, 0x19, action, next);
+    set_transition(state, 0x1C, 0x1F, action, next);
+}
+
+INTERNAL void init_transition_table() {
+    for (u32 state = 0; state < ANSI_STATE_COUNT; state += 1) {
+        set_transition(state, 0x00, 0xFF, ANSI_ACTION_IGNORE, state);
+    }
+
+    set_c0_transition(ANSI_STATE_GROUND, ANSI_ACTION_EXECUTE, ANSI_STATE_GROUND);
+    set_transition(ANSI_STATE_GROUND, 0x20, 0x7E, ANSI_ACTION_PRINT, ANSI_STATE_GROUND);
+    set_transition(ANSI_STATE_GROUND, 0x80, 0xFF, ANSI_ACTION_PRINT, ANSI_STATE_GROUND);
+
+    set_c0_transition(ANSI_STATE_ESCAPE, ANSI_ACTION_EXECUTE, ANSI_STATE_ESCAPE);
+    set_transition(ANSI_STATE_ESCAPE, 0x20, 0x2F, ANSI_ACTION_COLLECT, ANSI_STATE_ESCAPE_INTERMEDIATE);
+    set_transition(ANSI_STATE_ESCAPE, 0x30, 0x7E, ANSI_ACTION_ESC_DISPATCH, ANSI_STATE_GROUND);
+    set_transition(ANSI_STATE_ESCAPE, 'P', 'P', ANSI_ACTION_NONE, ANSI_STATE_DCS_ENTRY);
+    set_transition(ANSI_STATE_ESCAPE, 'X', 'X', ANSI_ACTION_NONE, ANSI_STATE_SOS_PM_APC_STRING);
+    set_transition(ANSI_STATE_ESCAPE, '[', '[', ANSI_ACTION_NONE, ANSI_STATE_CSI_ENTRY);
+    set_transition(ANSI_STATE_ESCAPE, ']', ']', ANSI_ACTION_NONE, ANSI_STATE_OSC_STRING);
+    set_transition(ANSI_STATE_ESCAPE, '^', '_', ANSI_ACTION_NONE, ANSI_STATE_SOS_PM_APC_STRING);
+
+    set_c0_transition(ANSI_STATE_ESCAPE_INTERMEDIATE, ANSI_ACTION_EXECUTE, ANSI_STATE_ESCAPE_INTERMEDIATE);
+    set_transition(ANSI_STATE_ESCAPE_INTERMEDIATE, 0x20, 0x2F, ANSI_ACTION_COLLECT, ANSI_STATE_ESCAPE_INTERMEDIATE);
+    set_transition(ANSI_STATE_ESCAPE_INTERMEDIATE, 0x30, 0x7E, ANSI_ACTION_ESC_DISPATCH, ANSI_STATE_GROUND);
+
+    // NOTE: ':' separates sub parameters (e.g. 38:2::r:g:b). They are not supported, so the whole
+    //       sequence is ignored instead of misreading the sub parameters as arguments.
+    set_c0_transition(ANSI_STATE_CSI_ENTRY, ANSI_ACTION_EXECUTE, ANSI_STATE_CSI_ENTRY);
+    set_transition(ANSI_STATE_CSI_ENTRY, 0x20, 0x2F, ANSI_ACTION_COLLECT, ANSI_STATE_CSI_INTERMEDIATE);
+    set_transition(ANSI_STATE_CSI_ENTRY, 0x30, 0x39, ANSI_ACTION_PARAM, ANSI_STATE_CSI_PARAM);
+    set_transition(ANSI_STATE_CSI_ENTRY, 0x3A, 0x3A, ANSI_ACTION_NONE, ANSI_STATE_CSI_IGNORE);
+    set_transition(ANSI_STATE_CSI_ENTRY, 0x3B, 0x3B, ANSI_ACTION_PARAM, ANSI_STATE_CSI_PARAM);
+    set_transition(ANSI_STATE_CSI_ENTRY, 0x3C, 0x3F, ANSI_ACTION_COLLECT, ANSI_STATE_CSI_PARAM);
+    set_transition(ANSI_STATE_CSI_ENTRY, 0x40, 0x7E, ANSI_ACTION_CSI_DISPATCH, ANSI_STATE_GROUND);
+
+    set_c0_transition(ANSI_STATE_CSI_PARAM, ANSI_ACTION_EXECUTE, ANSI_STATE_CSI_PARAM);
+    set_transition(ANSI_STATE_CSI_PARAM, 0x20, 0x2F, ANSI_ACTION_COLLECT, ANSI_STATE_CSI_INTERMEDIATE);
+    set_transition(ANSI_STATE_CSI_PARAM, 0x30, 0x39, ANSI_ACTION_PARAM, ANSI_STATE_CSI_PARAM);
+    set_transition(ANSI_STATE_CSI_PARAM, 0x3A, 0x3A, ANSI_ACTION_NONE, ANSI_STATE_CSI_IGNORE);
+    set_transition(ANSI_STATE_CSI_PARAM, 0x3B, 0x3B, ANSI_ACTION_PARAM, ANSI_STATE_CSI_PARAM);
+    set_transition(ANSI_STATE_CSI_PARAM, 0x3C, 0x3F, ANSI_ACTION_NONE, ANSI_STATE_CSI_IGNORE);
+    set_transition(ANSI_STATE_CSI_PARAM, 0x40, 0x7E, ANSI_ACTION_CSI_DISPATCH, ANSI_STATE_GROUND);
+
+    set_c0_transition(ANSI_STATE_CSI_INTERMEDIATE, ANSI_ACTION_EXECUTE, ANSI_STATE_CSI_INTERMEDIATE);
+    set_transition(ANSI_STATE_CSI_INTERMEDIATE, 0x20, 0x2F, ANSI_ACTION_COLLECT, ANSI_STATE_CSI_INTERMEDIATE);
+    set_transition(ANSI_STATE_CSI_INTERMEDIATE, 0x30, 0x3F, ANSI_ACTION_NONE, ANSI_STATE_CSI_IGNORE);
+    set_transition(ANSI_STATE_CSI_INTERMEDIATE, 0x40, 0x7E, ANSI_ACTION_CSI_DISPATCH, ANSI_STATE_GROUND);
+
+    set_c0_transition(ANSI_STATE_CSI_IGNORE, ANSI_ACTION_EXECUTE, ANSI_STATE_CSI_IGNORE);
+    set_transition(ANSI_STATE_CSI_IGNORE, 0x40, 0x7E, ANSI_ACTION_NONE, ANSI_STATE_GROUND);
 
-            if (str[index] < 0x40 || str[index] > 0x7E) {
-                String error = {str.data, index};
-                LOG(LOG_ERROR, "Unsupported ANSI escape sequence %S.", error);
+    set_transition(ANSI_STATE_DCS_ENTRY, 0x20, 0x2F, ANSI_ACTION_COLLECT, ANSI_STATE_DCS_INTERMEDIATE);
+    set_transition(ANSI_STATE_DCS_ENTRY, 0x30, 0x39, ANSI_ACTION_PARAM, ANSI_STATE_DCS_PARAM);
+    set_transition(ANSI_STATE_DCS_ENTRY, 0x3A, 0x3A, ANSI_ACTION_NONE, ANSI_STATE_DCS_IGNORE);
+    set_transition(ANSI_STATE_DCS_ENTRY, 0x3B, 0x3B, ANSI_ACTION_PARAM, ANSI_STATE_DCS_PARAM);
+    set_transition(ANSI_STATE_DCS_ENTRY, 0x3C, 0x3F, ANSI_ACTION_COLLECT, ANSI_STATE_DCS_PARAM);
+    set_transition(ANSI_STATE_DCS_ENTRY, 0x40, 0x7E, ANSI_ACTION_NONE, ANSI_STATE_DCS_PASSTHROUGH);
+
+    set_transition(ANSI_STATE_DCS_PARAM, 0x20, 0x2F, ANSI_ACTION_COLLECT, ANSI_STATE_DCS_INTERMEDIATE);
+    set_transition(ANSI_STATE_DCS_PARAM, 0x30, 0x39, ANSI_ACTION_PARAM, ANSI_STATE_DCS_PARAM);
+    set_transition(ANSI_STATE_DCS_PARAM, 0x3A, 0x3A, ANSI_ACTION_NONE, ANSI_STATE_DCS_IGNORE);
+    set_transition(ANSI_STATE_DCS_PARAM, 0x3B, 0x3B, ANSI_ACTION_PARAM, ANSI_STATE_DCS_PARAM);
+    set_transition(ANSI_STATE_DCS_PARAM, 0x3C, 0x3F, ANSI_ACTION_NONE, ANSI_STATE_DCS_IGNORE);
+    set_transition(ANSI_STATE_DCS_PARAM, 0x40, 0x7E, ANSI_ACTION_NONE, ANSI_STATE_DCS_PASSTHROUGH);
+
+    set_transition(ANSI_STATE_DCS_INTERMEDIATE, 0x20, 0x2F, ANSI_ACTION_COLLECT, ANSI_STATE_DCS_INTERMEDIATE);
+    set_transition(ANSI_STATE_DCS_INTERMEDIATE, 0x30, 0x3F, ANSI_ACTION_NONE, ANSI_STATE_DCS_IGNORE);
+    set_transition(ANSI_STATE_DCS_INTERMEDIATE, 0x40, 0x7E, ANSI_ACTION_NONE, ANSI_STATE_DCS_PASSTHROUGH);
+
+    set_c0_transition(ANSI_STATE_DCS_PASSTHROUGH, ANSI_ACTION_PUT, ANSI_STATE_DCS_PASSTHROUGH);
+    set_transition(ANSI_STATE_DCS_PASSTHROUGH, 0x20, 0x7E, ANSI_ACTION_PUT, ANSI_STATE_DCS_PASSTHROUGH);
+    set_transition(ANSI_STATE_DCS_PASSTHROUGH, 0x80, 0xFF, ANSI_ACTION_PUT, ANSI_STATE_DCS_PASSTHROUGH);
+
+    // NOTE: xterm also accepts BEL as the terminator of an OSC string.
+    set_transition(ANSI_STATE_OSC_STRING, 0x07, 0x07, ANSI_ACTION_NONE, ANSI_STATE_GROUND);
+    set_transition(ANSI_STATE_OSC_STRING, 0x20, 0x7F, ANSI_ACTION_OSC_PUT, ANSI_STATE_OSC_STRING);
+    set_transition(ANSI_STATE_OSC_STRING, 0x80, 0xFF, ANSI_ACTION_OSC_PUT, ANSI_STATE_OSC_STRING);
+
+    // Transitions from anywhere.
+    for (u32 state = 0; state < ANSI_STATE_COUNT; state += 1) {
+        set_transition(state, 0x18, 0x18, ANSI_ACTION_EXECUTE, ANSI_STATE_GROUND);
+        set_transition(state, 0x1A, 0x1A, ANSI_ACTION_EXECUTE, ANSI_STATE_GROUND);
+        set_transition(state, 0x1B, 0x1B, ANSI_ACTION_NONE, ANSI_STATE_ESCAPE);
+    }
+
+    TransitionTableInitialized = true;
+}
+
+void init(ANSIParser *parser) {
+    if (!TransitionTableInitialized) init_transition_table();
+
+    INIT_STRUCT(parser);
+}
+
+// Arguments bigger than this are clamped, no sequence needs them and it keeps the accumulation from overflowing.
+s32 const EscapeSequenceMaxArgValue = 0xFFFF;
+
+INTERNAL void push_current_arg(ANSIParser *parser) {
+    if (parser->seq.arg_count < EscapeSequenceMaxArgs) {
+        parser->seq.args[parser->seq.arg_count] = parser->current_arg;
+        parser->seq.arg_count += 1;
+    }
+
+    parser->current_arg = 0;
+}
+
+INTERNAL ANSIEventKind perform_action(ANSIParser *parser, u32 action, u8 c) {
+    switch (action) {
+    case ANSI_ACTION_PRINT:   return ANSI_EVENT_PRINT;
+    case ANSI_ACTION_EXECUTE: return ANSI_EVENT_EXECUTE;
+
+    case ANSI_ACTION_CLEAR: {
+        parser->seq.arg_count = 0;
+        parser->seq.intermediate_count = 0;
+        parser->current_arg = 0;
+    } break;
+
+    case ANSI_ACTION_COLLECT: {
+        if (parser->seq.intermediate_count < EscapeSequenceMaxIntermediates) {
+            parser->seq.intermediates[parser->seq.intermediate_count] = c;
+            parser->seq.intermediate_count += 1;
+        }
+    } break;
 
-                return {};
+    case ANSI_ACTION_PARAM: {
+        if (c == ';') {
+            push_current_arg(parser);
+        } else {
+            parser->current_arg = parser->current_arg * 10 + (c - '0');
+            if (parser->current_arg > EscapeSequenceMaxArgValue) parser->current_arg = EscapeSequenceMaxArgValue;
+        }
+    } break;
+
+    case ANSI_ACTION_ESC_DISPATCH: {
+        parser->seq.kind = c;
+
+        return ANSI_EVENT_ESC_DISPATCH;
+    } break;
+
+    case ANSI_ACTION_CSI_DISPATCH: {
+        // NOTE: The last argument is always pushed so a missing one shows up as 0, e.g. "\x1b[m".
+        push_current_arg(parser);
+        parser->seq.kind = c;
+
+        return ANSI_EVENT_CSI_DISPATCH;
+    } break;
+
+    // NOTE: DCS and OSC strings (window title, ...) are not supported yet. They are still
+    //       consumed by the state machine so their contents don't end up on screen.
+    case ANSI_ACTION_HOOK:
+    case ANSI_ACTION_PUT:
+    case ANSI_ACTION_UNHOOK:
+    case ANSI_ACTION_OSC_START:
+    case ANSI_ACTION_OSC_PUT:
+    case ANSI_ACTION_OSC_END:
+    break;
+    }
+
+    return ANSI_EVENT_NONE;
+}
+
+u32 const UnicodeReplacementCharacter = 0xFFFD;
+
+// Decodes one byte of UTF-8 in the ground state. Returns true when a code point is complete.
+// If the byte can't continue the current character it is left for the caller to process again.
+INTERNAL b32 decode_utf8(ANSIParser *parser, u8 c, u32 *cp, b32 *consumed) {
+    *consumed = true;
+
+    if (parser->utf8_remaining) {
+        if ((c & 0xC0) != 0x80) {
+            parser->utf8_remaining = 0;
+
+            *cp = UnicodeReplacementCharacter;
+            *consumed = false;
+
+            return true;
+        }
+
+        parser->utf8_cp = (parser->utf8_cp << 6) | (c & 0x3F);
+        parser->utf8_remaining -= 1;
+        if (parser->utf8_remaining) return false;
+
+        *cp = parser->utf8_cp;
+        if (*cp < parser->utf8_min || *cp > 0x10FFFF || (*cp >= 0xD800 && *cp <= 0xDFFF)) {
+            *cp = UnicodeReplacementCharacter;
+        }
+
+        return true;
+    }
+
+    if (c >= 0xC2 && c <= 0xDF) {
+        parser->utf8_cp  = c & 0x1F;
+        parser->utf8_min = 0x80;
+        parser->utf8_remaining = 1;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        parser->utf8_cp  = c & 0x0F;
+        parser->utf8_min = 0x800;
+        parser->utf8_remaining = 2;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        parser->utf8_cp  = c & 0x07;
+        parser->utf8_min = 0x10000;
+        parser->utf8_remaining = 3;
+    } else {
+        *cp = UnicodeReplacementCharacter;
+
+        return true;
+    }
+
+    return false;
+}
+
+ANSIEvent parse_next(ANSIParser *parser, String *input) {
+    ANSIEvent event = {};
+
+    u8 *ptr = input->data;
+    u8 *end = input->data + input->size;
+
+    while (ptr != end) {
+        u8 c = *ptr;
+
+        if (parser->state == ANSI_STATE_GROUND && (c >= 0x80 || parser->utf8_remaining)) {
+            u32 cp;
+            b32 consumed;
+            b32 complete = decode_utf8(parser, c, &cp, &consumed);
+
+            if (consumed) ptr += 1;
+
+            if (complete) {
+                event.kind = ANSI_EVENT_PRINT;
+                event.cp   = cp;
+
+                break;
             }
 
-            seq.kind = str[index];
+            continue;
+        }
+
+        ptr += 1;
+
+        u8  transition = TransitionTable[parser->state][c];
+        u32 action = transition >> 4;
+        u32 next   = transition & 0x0F;
+
+        ANSIEventKind kind;
+        if (next != parser->state) {
+            perform_action(parser, ExitActions[parser->state], c);
+            kind = perform_action(parser, action, c);
+            perform_action(parser, EntryActions[next], c);
+
+            parser->state = next;
+        } else {
+            kind = perform_action(parser, action, c);
+        }
+
+        if (kind != ANSI_EVENT_NONE) {
+            event.kind = kind;
+            event.cp   = c;
+            event.seq  = &parser->seq;
 
-            index += 1;
-            seq.valid = true;
+            break;
         }
     }
 
-    seq.length_in_bytes = index;
+    input->size -= ptr - input->data;
+    input->data  = ptr;
 
-    return seq;
+    return event;
 }
 
 u32 ansi_4bit_color(u32 color_name) {
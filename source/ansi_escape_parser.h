@@ -3,17 +3,68 @@
 #include "definitions.h"
 
 
-u32 const EscapeSequenceMaxArgs = 16;
+s32 const EscapeSequenceMaxArgs = 16;
+s32 const EscapeSequenceMaxIntermediates = 2;
 struct EscapeSequence {
-    b32 valid;
+    u32 kind; // The final byte of the sequence.
 
-    u32 kind;
     s32 args[EscapeSequenceMaxArgs];
     s32 arg_count;
 
-    s32 length_in_bytes;
+    // Intermediate bytes (0x20-0x2F) and private markers like '?' (0x3C-0x3F).
+    u8  intermediates[EscapeSequenceMaxIntermediates];
+    s32 intermediate_count;
 };
 
+// The states and actions follow the DEC compatible parser described by Paul Williams
+// (https://vt100.net/emu/dec_ansi_parser). The only deviation is that GROUND decodes UTF-8
+// instead of treating 0x80-0x9F as C1 controls.
+enum ANSIParserState {
+    ANSI_STATE_GROUND,
+    ANSI_STATE_ESCAPE,
+    ANSI_STATE_ESCAPE_INTERMEDIATE,
+    ANSI_STATE_CSI_ENTRY,
+    ANSI_STATE_CSI_PARAM,
+    ANSI_STATE_CSI_INTERMEDIATE,
+    ANSI_STATE_CSI_IGNORE,
+    ANSI_STATE_DCS_ENTRY,
+    ANSI_STATE_DCS_PARAM,
+    ANSI_STATE_DCS_INTERMEDIATE,
+    ANSI_STATE_DCS_PASSTHROUGH,
+    ANSI_STATE_DCS_IGNORE,
+    ANSI_STATE_OSC_STRING,
+    ANSI_STATE_SOS_PM_APC_STRING,
+
+    ANSI_STATE_COUNT,
+};
+
+enum ANSIEventKind {
+    ANSI_EVENT_NONE, // The input is exhausted.
+    ANSI_EVENT_PRINT,
+    ANSI_EVENT_EXECUTE,
+    ANSI_EVENT_ESC_DISPATCH,
+    ANSI_EVENT_CSI_DISPATCH,
+};
+struct ANSIEvent {
+    ANSIEventKind kind;
+
+    u32 cp; // The code point to print or the control character to execute.
+    EscapeSequence *seq; // Only valid until the next call to parse_next.
+};
+
+// All state lives in here, so input can be split at any byte and is never looked at twice.
+struct ANSIParser {
+    u8 state;
+
+    EscapeSequence seq;
+    s32 current_arg;
+
+    u32 utf8_cp;
+    u32 utf8_min; // Smallest code point allowed for the current length, used to reject overlong encodings.
+    s32 utf8_remaining;
+};
+
+
 enum {
     ESCAPE_CSI_RESET = 0,
 
@@ -61,7 +112,10 @@ enum {
 };
 
 
-EscapeSequence parse_escape_sequence(String str);
+void init(ANSIParser *parser);
+
+// Consumes bytes from the front of input until something happened that the caller needs to handle.
+ANSIEvent parse_next(ANSIParser *parser, String *input);
 
 u32 ansi_4bit_color(u32 color_name);
 u32 ansi_8bit_color(u8 index);
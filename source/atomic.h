@@ -0,0 +1,61 @@
+#pragma once
+
+#include "definitions.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+// NOTE: Only covers what the single producer/single consumer queues need.
+//       On x86/x64 aligned loads and stores already have acquire/release semantics,
+//       so with MSVC it is enough to keep the compiler from reordering.
+
+inline s64 atomic_load_acquire(s64 volatile *value) {
+#ifdef _MSC_VER
+    s64 result = *value;
+    _ReadWriteBarrier();
+
+    return result;
+#else
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+inline void atomic_store_release(s64 volatile *value, s64 new_value) {
+#ifdef _MSC_VER
+    _ReadWriteBarrier();
+    *value = new_value;
+#else
+    __atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+#endif
+}
+
+inline s32 atomic_load_acquire(s32 volatile *value) {
+#ifdef _MSC_VER
+    s32 result = *value;
+    _ReadWriteBarrier();
+
+    return result;
+#else
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+inline void atomic_store_release(s32 volatile *value, s32 new_value) {
+#ifdef _MSC_VER
+    _ReadWriteBarrier();
+    *value = new_value;
+#else
+    __atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+#endif
+}
+
+// Orders earlier stores before later loads, which acquire/release alone does not.
+inline void atomic_full_barrier() {
+#ifdef _MSC_VER
+    _mm_mfence();
+#else
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
@@ -0,0 +1,588 @@
+#include "benchmark.h"
+#include "console.h"
+#include "font.h"
+#include "platform.h"
+#include "io.h"
+#include "string2.h"
+#include "memory.h"
+#include "utf.h"
+
+
+// NOTE: xorshift64. The workloads have to be byte for byte the same on every run and machine,
+//       else the numbers are not comparable against the baseline.
+struct BenchmarkRandom {
+    u64 state;
+};
+
+INTERNAL u32 next_random(BenchmarkRandom *random) {
+    u64 x = random->state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    random->state = x;
+
+    return (u32)(x >> 32);
+}
+
+// Both bounds are inclusive.
+INTERNAL u32 random_range(BenchmarkRandom *random, u32 min, u32 max) {
+    return min + next_random(random) % (max - min + 1);
+}
+
+INTERNAL void append_letters(StringBuilder *builder, BenchmarkRandom *random, s32 count) {
+    for (s32 i = 0; i < count; i += 1) {
+        append(builder, (u8)random_range(random, 'a', 'z'));
+    }
+}
+
+INTERNAL void append_code_point(StringBuilder *builder, u32 cp) {
+    UTF8CharResult c = to_utf8(cp);
+    append_raw(builder, c.byte, c.length);
+}
+
+
+// Every workload function appends one line, or whatever the unit of the workload is.
+typedef void WorkloadFunc(StringBuilder *builder, BenchmarkRandom *random);
+
+INTERNAL void dense_ascii_workload(StringBuilder *builder, BenchmarkRandom *random) {
+    s32 length = random_range(random, 20, 120);
+
+    for (s32 i = 0; i < length; i += 1) {
+        append(builder, (u8)random_range(random, 0x20, 0x7E));
+    }
+    append(builder, (u8)'\n');
+}
+
+INTERNAL void sgr_colors_workload(StringBuilder *builder, BenchmarkRandom *random) {
+    u32 const attributes[] = {0, 1, 3, 4};
+
+    for (s32 word = 0; word < 12; word += 1) {
+        u32 attribute = attributes[random_range(random, 0, ARRAY_SIZE(attributes) - 1)];
+
+        if (random_range(random, 0, 3) == 0) {
+            format(builder, "\x1b[%u;38;5;%um", attribute, random_range(random, 0, 255));
+        } else {
+            u32 color = random_range(random, 0, 15);
+            u32 fg = color < 8 ? 30 + color : 90 + (color - 8);
+
+            format(builder, "\x1b[%u;%um", attribute, fg);
+        }
+
+        append_letters(builder, random, random_range(random, 2, 9));
+        append(builder, (u8)' ');
+    }
+    append(builder, "\x1b[0m\n");
+}
+
+INTERNAL void true_color_workload(StringBuilder *builder, BenchmarkRandom *random) {
+    for (s32 column = 0; column < 80;) {
+        format(builder, "\x1b[38;2;%u;%u;%um", random_range(random, 0, 255), random_range(random, 0, 255), random_range(random, 0, 255));
+        if (random_range(random, 0, 1)) {
+            format(builder, "\x1b[48;2;%u;%u;%um", random_range(random, 0, 255), random_range(random, 0, 255), random_range(random, 0, 255));
+        }
+
+        s32 run = random_range(random, 1, 4);
+        append_letters(builder, random, run);
+        column += run;
+    }
+    append(builder, "\x1b[0m\n");
+}
+
+INTERNAL void cursor_storm_workload(StringBuilder *builder, BenchmarkRandom *random) {
+    char const directions[] = {'A', 'B', 'C', 'D'};
+
+    for (s32 move = 0; move < 16; move += 1) {
+        format(builder, "\x1b[%u", random_range(random, 1, 8));
+        append(builder, (u8)directions[random_range(random, 0, 3)]);
+        append_letters(builder, random, random_range(random, 1, 6));
+    }
+    append(builder, (u8)'\n');
+}
+
+INTERNAL void long_lines_workload(StringBuilder *builder, BenchmarkRandom *random) {
+    append_letters(builder, random, random_range(random, KILOBYTES(16), KILOBYTES(64)));
+    append(builder, (u8)'\n');
+}
+
+INTERNAL void wide_unicode_workload(StringBuilder *builder, BenchmarkRandom *random) {
+    for (s32 i = 0; i < 40; i += 1) {
+        u32 cp;
+        switch (random_range(random, 0, 3)) {
+        case 0:  cp = random_range(random, 0x4E00, 0x9FFF);   break; // CJK
+        case 1:  cp = random_range(random, 0xAC00, 0xD7A3);   break; // Hangul
+        case 2:  cp = random_range(random, 0x1F300, 0x1F5FF); break; // Emoji
+        default: cp = random_range(random, 0x0410, 0x044F);   break; // Cyrillic
+        }
+
+        append_code_point(builder, cp);
+    }
+    append(builder, (u8)'\n');
+}
+
+INTERNAL void progress_bar_workload(StringBuilder *builder, BenchmarkRandom *random) {
+    s32 width = random_range(random, 20, 60);
+
+    for (s32 done = 0; done <= width; done += 1) {
+        append(builder, "\r[");
+        for (s32 i = 0; i < width; i += 1) {
+            append(builder, (u8)(i < done ? '#' : ' '));
+        }
+        format(builder, "] %d", done * 100 / width);
+        append(builder, (u8)'%');
+    }
+    append(builder, (u8)'\n');
+}
+
+// A pager with a title line: the rows below it form a scroll region and every line feed at its
+// bottom scrolls the whole region. The margin is clamped to the screen, so any grid size works.
+INTERNAL void region_scroll_workload(StringBuilder *builder, BenchmarkRandom *random) {
+    append(builder, "\x1b[2;999r\x1b[1;1H\x1b[1mtitle\x1b[0m\x1b[999;1H");
+
+    for (s32 line = 0; line < 16; line += 1) {
+        append(builder, (u8)'\n');
+        append_letters(builder, random, random_range(random, 20, 80));
+    }
+}
+
+// Scrolling backwards through a pager, plus inserting and deleting lines in the middle.
+INTERNAL void reverse_scroll_workload(StringBuilder *builder, BenchmarkRandom *random) {
+    for (s32 line = 0; line < 8; line += 1) {
+        append(builder, "\x1b[H\x1bM");
+        append_letters(builder, random, random_range(random, 20, 80));
+    }
+
+    format(builder, "\x1b[%u;1H\x1b[%uL", random_range(random, 1, 20), random_range(random, 1, 4));
+    append_letters(builder, random, random_range(random, 20, 80));
+    format(builder, "\x1b[%uM\x1b[%uS\x1b[%uT", random_range(random, 1, 4), random_range(random, 1, 4), random_range(random, 1, 4));
+}
+
+// Like watch: clear the screen and redraw a handful of lines, over and over.
+INTERNAL void clear_screen_workload(StringBuilder *builder, BenchmarkRandom *random) {
+    append(builder, "\x1b[H\x1b[2J");
+
+    for (s32 line = 0; line < 10; line += 1) {
+        append_letters(builder, random, random_range(random, 20, 80));
+        append(builder, (u8)'\n');
+    }
+}
+
+// Fixed 80 column lines, one plain, one colored like a directory listing and one with a 24 bit
+// color per character. Mostly there for the bytes per line the scrollback needs for them.
+INTERNAL void mixed_lines_workload(StringBuilder *builder, BenchmarkRandom *random) {
+    s32 const columns = 80;
+
+    append_letters(builder, random, columns);
+    append(builder, (u8)'\n');
+
+    for (s32 x = 0; x < columns; x += 16) {
+        format(builder, "\x1b[%um", random_range(random, 31, 37));
+        append_letters(builder, random, 15);
+        append(builder, "\x1b[0m ");
+    }
+    append(builder, (u8)'\n');
+
+    for (s32 x = 0; x < columns; x += 1) {
+        format(builder, "\x1b[38;2;%u;%u;%um", random_range(random, 0, 255), random_range(random, 0, 255), random_range(random, 0, 255));
+        append_letters(builder, random, 1);
+    }
+    append(builder, "\x1b[0m\n");
+}
+
+struct Workload {
+    char const *name;
+    WorkloadFunc *func;
+};
+
+INTERNAL Workload Workloads[] = {
+    {"dense_ascii",    dense_ascii_workload},
+    {"sgr_colors",     sgr_colors_workload},
+    {"true_color",     true_color_workload},
+    {"cursor_storm",   cursor_storm_workload},
+    {"long_lines",     long_lines_workload},
+    {"wide_unicode",   wide_unicode_workload},
+    {"progress_bars",  progress_bar_workload},
+    {"region_scroll",  region_scroll_workload},
+    {"reverse_scroll", reverse_scroll_workload},
+    {"clear_screen",   clear_screen_workload},
+    {"mixed_lines",    mixed_lines_workload},
+};
+
+
+INTERNAL String generate_workload(Workload *workload, s64 size) {
+    BenchmarkRandom random = {0x9E3779B97F4A7C15ull};
+
+    StringBuilder builder = {};
+    DEFER(destroy(&builder));
+
+    while (builder.total_size < size) {
+        workload->func(&builder, &random);
+    }
+
+    return to_allocated_string(&builder);
+}
+
+// Everything the buffer allocated that grows with the input.
+INTERNAL s64 engine_memory(ConsoleBuffer *buffer) {
+    s64 memory = scrollback_memory(buffer);
+    memory += buffer->lines.alloc * sizeof(LineInfo);
+    memory += buffer->screen.cells.size * sizeof(ConsoleTile);
+    memory += buffer->display_buffer.alloc * sizeof(ConsoleTile);
+    memory += buffer->styles.styles.alloc * sizeof(ConsoleStyle);
+
+    return memory;
+}
+
+struct BenchmarkResult {
+    String name;
+
+    s64 bytes_per_second;
+    s64 peak_memory;
+    s64 bytes_per_line; // Ring and line index per scrollback line, 0 if nothing was scrolled back.
+};
+
+// NOTE: The ring is big enough for every workload at the default sizes, so no line was dropped
+//       and everything that scrolled off the screen is counted.
+INTERNAL s64 scrollback_bytes_per_line(ConsoleBuffer *buffer) {
+    s64 lines = scrollback_line_count(buffer);
+    if (lines == 0) return 0;
+
+    return (buffer->ring.size + lines * (s64)sizeof(LineInfo)) / lines;
+}
+
+INTERNAL BenchmarkResult run_workload(BenchmarkOptions *options, Workload *workload, String input) {
+    BenchmarkResult result = {};
+    result.name = workload->name;
+
+    r64 best_time = 0;
+
+    for (s32 run = 0; run < options->runs; run += 1) {
+        ConsoleBuffer buffer = {};
+        init(&buffer);
+
+        // NOTE: The last row of the display belongs to the prompt, see visible_lines.
+        buffer.tile_count = {options->size.x, options->size.y + 1};
+
+        s64 peak_memory = engine_memory(&buffer);
+        r64 time = 0;
+
+        String rest = input;
+        while (rest.size) {
+            s64 size = rest.size;
+            if (size > options->chunk) size = options->chunk;
+
+            // NOTE: One append is one frame worth of output, see timed_append in headless.cpp.
+            r64 start = platform_get_time();
+            append(&buffer, {rest.data, size});
+            update_display_buffer(&buffer);
+            time += platform_get_time() - start;
+
+            s64 memory = engine_memory(&buffer);
+            if (memory > peak_memory) peak_memory = memory;
+
+            rest = shrink_front(rest, size);
+        }
+
+        result.bytes_per_line = scrollback_bytes_per_line(&buffer);
+
+        destroy(&buffer);
+
+        if (run == 0 || time < best_time) best_time = time;
+        result.peak_memory = peak_memory;
+    }
+
+    if (best_time <= 0) best_time = 1.0e-9;
+    result.bytes_per_second = (s64)(input.size / best_time);
+
+    return result;
+}
+
+
+// Splits off the next space separated value, the last one is the rest of the text.
+INTERNAL String next_value(String *text) {
+    SplitResult split = split_at(*text, ' ');
+    if (split.first.size == 0) {
+        String value = *text;
+        *text = {};
+
+        return value;
+    }
+
+    *text = split.second;
+
+    return split.first;
+}
+
+struct BenchmarkBaseline {
+    // What the results were measured with, they are only comparable to runs with the same settings.
+    V2i size;
+    s64 input_size;
+    s64 chunk;
+
+    DArray<BenchmarkResult> results;
+};
+
+INTERNAL b32 parse_settings(String values, BenchmarkBaseline *baseline) {
+    SplitResult size = split_at(next_value(&values), 'x');
+
+    s64 columns = 0, rows = 0;
+    b32 valid = parse_s64(size.first, &columns) && parse_s64(size.second, &rows) &&
+                parse_s64(next_value(&values), &baseline->input_size) && parse_s64(next_value(&values), &baseline->chunk);
+
+    baseline->size = {(s32)columns, (s32)rows};
+
+    return valid && values.size == 0;
+}
+
+// Starts with a line "settings <columns>x<rows> <bytes per workload> <bytes per append>", followed by
+// one workload per line: <name> <bytes per second> <peak memory> <bytes per line>. Lines starting
+// with # are ignored. Baselines from before bytes per line was measured don't have the last value.
+INTERNAL b32 parse_baseline(String content, BenchmarkBaseline *baseline) {
+    b32 has_settings = false;
+
+    for (GetLineResult line = get_text_line(&content); !line.empty; line = get_text_line(&content)) {
+        String text = trim(line.line);
+        if (text.size == 0 || text[0] == '#') continue;
+
+        String values = text;
+        String name = next_value(&values);
+
+        if (name == "settings") {
+            has_settings = parse_settings(values, baseline);
+            if (!has_settings) print("Malformed baseline settings: %S\n", text);
+
+            continue;
+        }
+
+        BenchmarkResult entry = {};
+        entry.name = name;
+
+        b32 valid = parse_s64(next_value(&values), &entry.bytes_per_second) && parse_s64(next_value(&values), &entry.peak_memory);
+        if (valid && values.size) valid = parse_s64(next_value(&values), &entry.bytes_per_line);
+
+        if (!valid || values.size) {
+            print("Skipping malformed baseline line: %S\n", text);
+            continue;
+        }
+
+        append(baseline->results, entry);
+    }
+
+    return has_settings;
+}
+
+INTERNAL BenchmarkResult *find_result(DArray<BenchmarkResult> *results, String name) {
+    FOR (*results, result) {
+        if (result->name == name) return result;
+    }
+
+    return 0;
+}
+
+INTERNAL b32 save_baseline(BenchmarkOptions *options, DArray<BenchmarkResult> *results, String file) {
+    StringBuilder builder = {};
+    DEFER(destroy(&builder));
+
+    format(&builder, "settings %dx%d %D %D\n", options->size.x, options->size.y, options->input_size, options->chunk);
+    append(&builder, "# name bytes_per_second peak_memory bytes_per_line\n");
+    FOR (*results, result) {
+        format(&builder, "%S %D %D %D\n", result->name, result->bytes_per_second, result->peak_memory, result->bytes_per_line);
+    }
+
+    return write_builder_to_file(&builder, file);
+}
+
+s32 run_benchmarks(BenchmarkOptions *options) {
+    String baseline_content = {};
+    BenchmarkBaseline baseline = {};
+    DEFER(destroy(baseline.results));
+
+    if (options->baseline.size) {
+        u32 status = 0;
+        baseline_content = read_entire_file(options->baseline, &status);
+        if (status != READ_ENTIRE_FILE_OK) {
+            print("Could not read the baseline %S.\n", options->baseline);
+            return 1;
+        }
+
+        if (!parse_baseline(baseline_content, &baseline)) {
+            print("The baseline %S does not say which settings it was measured with.\n", options->baseline);
+            return 1;
+        }
+
+        // NOTE: Numbers from another grid size or input are not comparable. That is not a failure,
+        //       but it should not go unnoticed either.
+        if (baseline.size.x != options->size.x || baseline.size.y != options->size.y ||
+            baseline.input_size != options->input_size || baseline.chunk != options->chunk) {
+            print("The baseline %S was measured with %dx%d, %D bytes in %D byte appends. Nothing is compared.\n",
+                  options->baseline, baseline.size.x, baseline.size.y, baseline.input_size, baseline.chunk);
+            baseline.results.size = 0;
+        }
+    }
+    DEFER(destroy_string(&baseline_content));
+
+    print("%D bytes per workload in %D byte appends, %d runs, %dx%d grid\n\n",
+          options->input_size, options->chunk, options->runs, options->size.x, options->size.y);
+
+    DArray<BenchmarkResult> results = {};
+    DEFER(destroy(results));
+
+    s32 regressions = 0;
+    r64 const threshold = options->threshold / 100.0;
+
+    for (s32 i = 0; i < (s32)ARRAY_SIZE(Workloads); i += 1) {
+        String input = generate_workload(&Workloads[i], options->input_size);
+        DEFER(destroy_string(&input));
+
+        BenchmarkResult result = run_workload(options, &Workloads[i], input);
+        append(results, result);
+
+        r64 mb_per_second = result.bytes_per_second / (1024.0 * 1024.0);
+        r64 ns_per_byte   = 1.0e9 / result.bytes_per_second;
+
+        print("%S: %f MB/s, %f ns/byte, peak %D KB, %D bytes/line\n", result.name, mb_per_second, ns_per_byte, result.peak_memory / 1024, result.bytes_per_line);
+
+        BenchmarkResult *base = find_result(&baseline.results, result.name);
+        if (!base) continue;
+
+        r64 speed_change  = (r64)result.bytes_per_second / base->bytes_per_second - 1.0;
+        r64 memory_change = (r64)result.peak_memory / base->peak_memory - 1.0;
+
+        print("    baseline %f MB/s, peak %D KB, speed %f percent, memory %f percent\n",
+              base->bytes_per_second / (1024.0 * 1024.0), base->peak_memory / 1024, speed_change * 100.0, memory_change * 100.0);
+
+        if (speed_change < -threshold) {
+            print("    REGRESSION: throughput dropped by more than %d percent\n", options->threshold);
+            regressions += 1;
+        }
+        if (memory_change > threshold) {
+            print("    REGRESSION: peak memory grew by more than %d percent\n", options->threshold);
+            regressions += 1;
+        }
+        if (base->bytes_per_line && (r64)result.bytes_per_line / base->bytes_per_line - 1.0 > threshold) {
+            print("    REGRESSION: bytes per line grew from %D to %D\n", base->bytes_per_line, result.bytes_per_line);
+            regressions += 1;
+        }
+    }
+
+    print("\nprocess peak memory: %D KB\n", platform_peak_memory_usage() / 1024);
+
+    if (options->save_baseline.size) {
+        if (save_baseline(options, &results, options->save_baseline)) {
+            print("Baseline written to %S.\n", options->save_baseline);
+        } else {
+            print("Could not write the baseline to %S.\n", options->save_baseline);
+        }
+    }
+
+    if (regressions) {
+        print("%d regressions.\n", regressions);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+struct GlyphWorkload {
+    char const *name;
+    u32 ascii_percent; // The rest is drawn from a fixed set of box drawing, shape and CJK code points.
+};
+
+INTERNAL GlyphWorkload GlyphWorkloads[] = {
+    {"ascii",        100},
+    {"mostly_ascii", 95},
+    {"unicode",      0},
+};
+
+// NOTE: Small enough to fit into the atlas, the benchmark is about lookups and not about evictions.
+s32 const GlyphBenchmarkUnicodeCount = 512;
+s64 const GlyphBenchmarkLookups = 20000000;
+
+INTERNAL u32 random_unicode_cell(BenchmarkRandom *random) {
+    u32 index = random_range(random, 0, GlyphBenchmarkUnicodeCount - 1);
+
+    if (index < 128) return 0x2500 + index;       // Box drawing
+    if (index < 256) return 0x25A0 + index - 128; // Geometric shapes
+    return 0x4E00 + index - 256;                  // CJK
+}
+
+s32 run_glyph_benchmark(BenchmarkOptions *options) {
+    ConsoleFont font = {};
+    init(&font, 20.0f, options->font_dir, "LiterationMono");
+
+    if (font.font_data[CONSOLE_FONT_REGULAR].file.content.size == 0) {
+        print("Could not load the regular console font from %S.\n", options->font_dir);
+        return 1;
+    }
+    b32 has_bold = font.font_data[CONSOLE_FONT_BOLD].file.content.size != 0;
+
+    s64 cells  = (s64)options->size.x * options->size.y;
+    s64 frames = GlyphBenchmarkLookups / cells;
+    if (frames < 1) frames = 1;
+
+    Array<u32> code_points = ALLOCATE_ARRAY(u32, cells);
+    Array<u32> kinds       = ALLOCATE_ARRAY(u32, cells);
+    DEFER(destroy_array(&code_points));
+    DEFER(destroy_array(&kinds));
+
+    print("%D lookups per run, %d runs, %dx%d grid\n\n", frames * cells, options->runs, options->size.x, options->size.y);
+
+    for (s32 i = 0; i < (s32)ARRAY_SIZE(GlyphWorkloads); i += 1) {
+        GlyphWorkload *workload = &GlyphWorkloads[i];
+        BenchmarkRandom random = {0x9E3779B97F4A7C15ull};
+
+        for (s64 cell = 0; cell < cells; cell += 1) {
+            b32 ascii = random_range(&random, 1, 100) <= workload->ascii_percent;
+            code_points[cell] = ascii ? random_range(&random, 0x20, 0x7E) : random_unicode_cell(&random);
+
+            // Every tenth cell is bold, like a highlighted word here and there.
+            kinds[cell] = has_bold && random_range(&random, 0, 9) == 0 ? CONSOLE_FONT_BOLD : CONSOLE_FONT_REGULAR;
+        }
+
+        // Rasterizing is not part of the measurement.
+        for (s64 cell = 0; cell < cells; cell += 1) get_glyph(&font, kinds[cell], code_points[cell]);
+
+        r64 best_time = 0;
+        u64 checksum  = 0;
+
+        for (s32 run = 0; run < options->runs; run += 1) {
+            r64 start = platform_get_time();
+
+            for (s64 frame = 0; frame < frames; frame += 1) {
+                next_font_frame(&font);
+
+                for (s64 cell = 0; cell < cells; cell += 1) {
+                    ConsoleGlyphInfo *glyph = get_glyph(&font, kinds[cell], code_points[cell]);
+                    checksum += glyph->offset_in_atlas.x;
+                }
+            }
+
+            r64 time = platform_get_time() - start;
+            if (run == 0 || time < best_time) best_time = time;
+        }
+
+        // The checksum only keeps the compiler from dropping the lookups.
+        r64 ns_per_cell = best_time * 1.0e9 / (frames * cells);
+        print("%s: %f ns/cell (checksum %U)\n", workload->name, ns_per_cell, checksum);
+    }
+
+    print("\nglyph cache: %D hits, %D misses, %D evictions\n", font.hits, font.misses, font.evictions);
+
+    // NOTE: Compares the shelves against one cell for every glyph, and against tight bounding boxes
+    //       as the best case. Wide glyphs cost a second cell but are no longer cut off.
+    ConsoleAtlasOccupancy occupancy = font_atlas_occupancy(&font);
+    if (occupancy.glyphs) {
+        r64 const megabyte = 1024.0 * 1024.0;
+        r64 cell_bytes = (r64)font.glyph_width * font.glyph_height;
+
+        print("atlas: %d glyphs (%d wide) in %d of %d cells, %d of %d shelves\n",
+              occupancy.glyphs, occupancy.wide_glyphs, occupancy.cells_used, occupancy.cells_total,
+              occupancy.shelves_used, occupancy.shelves_total);
+        print("glyphs per MB: fixed cells %f (%d cut off), shelves %f (%d cut off), tight boxes %f\n",
+              megabyte / cell_bytes, occupancy.wider_than_cell,
+              occupancy.glyphs * megabyte / (occupancy.cells_used * cell_bytes), occupancy.cut_off,
+              occupancy.ink_pixels ? occupancy.glyphs * megabyte / (r64)occupancy.ink_pixels : 0.0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "definitions.h"
+
+
+struct BenchmarkOptions {
+    V2i size;       // Grid size the buffer is set up with.
+    s64 input_size; // Bytes generated per workload.
+    s64 chunk;      // Bytes per append, like the pipe reader hands them out.
+    s32 runs;       // The fastest run counts.
+
+    String baseline;      // Compared against if set.
+    String save_baseline; // Results are written there if set.
+    s32 threshold;        // Allowed slowdown or memory growth in percent.
+
+    String font_dir; // Only for the glyph benchmark.
+};
+
+// Feeds a set of generated workloads through append and prints throughput and memory.
+// Returns non zero if a workload regressed against the baseline by more than the threshold.
+s32 run_benchmarks(BenchmarkOptions *options);
+
+// Looks up the glyph of every cell of the grid once per frame, like the text grid does when
+// everything is damaged, and prints the cost per cell for a few mixes of code points.
+s32 run_glyph_benchmark(BenchmarkOptions *options);
@@ -0,0 +1,1511 @@
+#include "console.h"
+#include "platform.h"
+#include "io.h"
+#include "string2.h"
+#include "memory.h"
+#include "utf.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define THERMAL_SCAN_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define THERMAL_SCAN_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+s32 const DefaultConsoleBufferSize = KILOBYTES(64);
+s32 const MaxConsoleBufferSize     = GIGABYTES(1);
+
+ScrollbackConfig const DefaultScrollbackConfig = {
+    0,               // max_lines
+    MEGABYTES(256),  // max_bytes
+};
+
+INTERNAL ScrollbackGovernor Governor = {
+    MEGABYTES(512), // budget
+    0,              // activity
+    {},             // buffers
+};
+
+
+s32 const DefaultScreenColumns = 80;
+s32 const DefaultScreenRows    = 24;
+
+
+V2i local_cursor_pos(ConsoleBuffer *buffer) {
+    V2i result = buffer->screen.cursor;
+    result.y += buffer->scroll_offset;
+
+    return result;
+}
+
+INTERNAL s64 ring_tile_capacity(ConsoleBuffer *buffer) {
+    return buffer->ring.alloc / sizeof(ConsoleTile);
+}
+
+// Absolute index of the oldest tile that is still inside the ring.
+INTERNAL s64 content_begin(ConsoleBuffer *buffer) {
+    return buffer->tile_end - buffer->ring.size / (s64)sizeof(ConsoleTile);
+}
+
+// The position is counted backwards from the end of the ring, so indices stay valid when the ring
+// gets resized.
+// NOTE: The ring is mapped twice so everything from the returned tile up to tile_end is contiguous.
+INTERNAL ConsoleTile *tile_at(ConsoleBuffer *buffer, s64 index) {
+    s64 position = buffer->ring.end / (s64)sizeof(ConsoleTile) - (buffer->tile_end - index);
+    if (position < 0) position += ring_tile_capacity(buffer);
+
+    return (ConsoleTile*)buffer->ring.memory + position;
+}
+
+s64 line_count(ConsoleBuffer *buffer) {
+    return buffer->lines.size - buffer->first_line;
+}
+
+LineInfo *get_line(ConsoleBuffer *buffer, s64 index) {
+    return &buffer->lines[buffer->first_line + index];
+}
+
+Array<ConsoleTile> line_tiles(ConsoleBuffer *buffer, LineInfo *info) {
+    Array<ConsoleTile> result = {};
+    result.memory = tile_at(buffer, info->start);
+    result.size   = info->size;
+
+    return result;
+}
+
+// NOTE: The index always ends with the line the next row from the screen will start. It is empty
+//       unless the last row that scrolled off was wrapped.
+s64 scrollback_line_count(ConsoleBuffer *buffer) {
+    s64 result = line_count(buffer);
+    if (result && get_line(buffer, result - 1)->size == 0) result -= 1;
+
+    return result;
+}
+
+INTERNAL void mark_lines_dirty(ConsoleBuffer *buffer, s64 index) {
+    if (!buffer->lines_dirty || index < buffer->lines_dirty_from) {
+        buffer->lines_dirty_from = index;
+    }
+    buffer->lines_dirty = true;
+}
+
+void register_scrollback(ConsoleBuffer *buffer) {
+    append(Governor.buffers, buffer);
+}
+
+void unregister_scrollback(ConsoleBuffer *buffer) {
+    for (s64 i = 0; i < Governor.buffers.size; i += 1) {
+        if (Governor.buffers[i] == buffer) {
+            stable_remove(Governor.buffers, i);
+            break;
+        }
+    }
+}
+
+s64 scrollback_memory(ConsoleBuffer *buffer) {
+    return buffer->ring.alloc + buffer->lines.alloc * sizeof(LineInfo);
+}
+
+INTERNAL void update_lines_after_shrink(ConsoleBuffer *buffer);
+
+// Frees memory from the least recently active buffers other than the requester until size more bytes fit into the budget.
+INTERNAL b32 reserve_scrollback_memory(ConsoleBuffer *requester, s64 size) {
+    for (;;) {
+        s64 used = 0;
+        FOR (Governor.buffers, it) used += scrollback_memory(*it);
+
+        if (used + size <= Governor.budget) return true;
+
+        ConsoleBuffer *victim = 0;
+        FOR (Governor.buffers, it) {
+            ConsoleBuffer *buffer = *it;
+            if (buffer == requester || buffer->ring.alloc <= DefaultConsoleBufferSize) continue;
+
+            if (!victim || buffer->last_activity < victim->last_activity) victim = buffer;
+        }
+
+        if (!victim) return false;
+
+        if (!platform_resize_ring_buffer(&victim->ring, victim->ring.alloc / 2)) return false;
+        update_lines_after_shrink(victim);
+    }
+}
+
+INTERNAL b32 grow_scrollback(ConsoleBuffer *buffer) {
+    ScrollbackConfig *config = &buffer->scrollback;
+    if (config->max_lines && line_count(buffer) >= config->max_lines) return false;
+
+    s64 size = (s64)buffer->ring.alloc * 2;
+    if (config->max_bytes && size > config->max_bytes) size = config->max_bytes;
+    if (size > MaxConsoleBufferSize) size = MaxConsoleBufferSize;
+
+    if (size <= buffer->ring.alloc) return false;
+
+    if (!reserve_scrollback_memory(buffer, size - buffer->ring.alloc)) return false;
+
+    if (!platform_resize_ring_buffer(&buffer->ring, size)) {
+        LOG(LOG_ERROR, "Could not grow the scrollback to %D bytes.\n", size);
+
+        return false;
+    }
+
+    return true;
+}
+
+b32 parse_scrollback_config(String text, ScrollbackConfig *config) {
+    text = trim(text);
+
+    s64 digits = 0;
+    while (digits < text.size && text[digits] >= '0' && text[digits] <= '9') digits += 1;
+
+    // NOTE: More digits than this would overflow, and no scrollback is that big anyway.
+    s64 count;
+    if (digits > 12 || !parse_s64(sub_string(text, 0, digits), &count) || count < 1) return false;
+
+    String unit = trim(shrink_front(text, digits));
+    if (equal_insensitive(unit, "lines")) {
+        *config = {count, 0};
+
+        return true;
+    }
+    if (equal_insensitive(unit, "mb") && count <= MaxConsoleBufferSize / MEGABYTES(1)) {
+        *config = {0, (s64)MEGABYTES(count)};
+
+        return true;
+    }
+
+    return false;
+}
+
+void set_scrollback(ConsoleBuffer *buffer, ScrollbackConfig config) {
+    buffer->scrollback = config;
+
+    // NOTE: A ring over the new limit is shrunk right away, which drops the oldest history.
+    //       The ring never gets smaller than it starts out.
+    s64 size = config.max_bytes;
+    if (size == 0 || size >= buffer->ring.alloc) return;
+    if (size < DefaultConsoleBufferSize) size = DefaultConsoleBufferSize;
+
+    if (!platform_resize_ring_buffer(&buffer->ring, (s32)size)) {
+        LOG(LOG_ERROR, "Could not shrink the scrollback to %D bytes.\n", size);
+
+        return;
+    }
+
+    update_lines_after_shrink(buffer);
+}
+
+// All writes to the ring go through here so tile_end stays in sync with the ring. The caller
+// keeps the line index up to date.
+// The scrollback only ever grows at the end, everything in front of the cursor lives on the screen.
+INTERNAL String write_ring(ConsoleBuffer *buffer, s32 size) {
+    // NOTE: Growing before a write that would drop history.
+    while (buffer->ring.size + size > buffer->ring.alloc && grow_scrollback(buffer)) {}
+
+    s32 old_end = buffer->ring.end;
+    String range = platform_writable_range(&buffer->ring, size, 0);
+
+    s32 advanced = buffer->ring.end - old_end;
+    if (advanced < 0) advanced += buffer->ring.alloc;
+
+    buffer->tile_end += advanced / sizeof(ConsoleTile);
+
+    return range;
+}
+
+INTERNAL b32 eat_new_line(Array<ConsoleTile> content, s64 *index) {
+    s64 i = *index;
+    b32 result = false;
+
+    if (content[i].cp == '\n') {
+        i += 1;
+        if (i < content.size && content[i].cp == '\r') i += 1;
+
+        result = true;
+    } else if (content[i].cp == '\r') {
+        i += 1;
+        if (i < content.size && content[i].cp == '\n') i += 1;
+
+        result = true;
+    }
+
+    *index = i;
+
+    return result;
+}
+
+INTERNAL void drop_overwritten_lines(ConsoleBuffer *buffer) {
+    s64 begin = content_begin(buffer);
+
+    while (line_count(buffer) > 1 && get_line(buffer, 1)->start <= begin) {
+        buffer->first_line += 1;
+    }
+
+    if (line_count(buffer)) {
+        LineInfo *first = get_line(buffer, 0);
+        if (first->start < begin) {
+            first->size -= begin - first->start;
+            if (first->size < 0) first->size = 0;
+
+            first->start = begin;
+        }
+    }
+
+    // Compact once the dead lines make up half of the array, so dropping lines stays O(1) amortized.
+    if (buffer->first_line && buffer->first_line >= buffer->lines.size / 2) {
+        stable_remove(buffer->lines, 0, buffer->first_line);
+        buffer->first_line = 0;
+    }
+}
+
+// A wide character that would only get the last column goes to the next line together with its spacer.
+INTERNAL b32 splits_wide_character(Array<ConsoleTile> content, s64 index, s32 line_size, s32 width) {
+    return line_size == width - 1 && index + 1 < content.size && content[index + 1].cp == ConsoleWideSpacer;
+}
+
+INTERNAL void update_line_index(ConsoleBuffer *buffer) {
+    drop_overwritten_lines(buffer);
+
+    if (!buffer->lines_dirty && line_count(buffer)) return;
+    buffer->lines_dirty = false;
+
+    s64 begin = content_begin(buffer);
+    s64 from  = buffer->lines_dirty_from;
+    if (from < begin) from = begin;
+
+    // Changes happen almost always close to the end, so search backwards.
+    s64 index = line_count(buffer) - 1;
+    while (index > 0 && get_line(buffer, index)->start > from) index -= 1;
+
+    // Rescan the previous line as well in case a \n\r pair got split between two writes.
+    if (index > 0) index -= 1;
+
+    LineInfo info = {begin, 0};
+    if (index >= 0) {
+        info.start = get_line(buffer, index)->start;
+        buffer->lines.size = buffer->first_line + index;
+    }
+
+    s64 scan_start = info.start;
+
+    Array<ConsoleTile> content = {};
+    content.memory = tile_at(buffer, scan_start);
+    content.size   = buffer->tile_end - scan_start;
+
+    LineInfo *current_line = append(buffer->lines, info);
+
+    for (s64 i = 0; i < content.size; i += 1) {
+        if (eat_new_line(content, &i) ) {
+            info.start = scan_start + i;
+            info.size  = 0;
+            current_line = append(buffer->lines, info);
+
+            i -= 1;
+        } else if (buffer->line_wrap && (current_line->size == buffer->screen.size.x || splits_wide_character(content, i, current_line->size, buffer->screen.size.x))) {
+            info.start = scan_start + i;
+            info.size  = 1;
+            current_line = append(buffer->lines, info);
+        } else {
+            current_line->size += 1;
+        }
+    }
+}
+
+void update_lines(ConsoleBuffer *buffer) {
+    update_line_index(buffer);
+}
+
+// The view can't be further back than the scrollback reaches.
+INTERNAL void clamp_scroll_offset(ConsoleBuffer *buffer) {
+    s64 max_scroll = scrollback_line_count(buffer);
+    if (buffer->scroll_offset > max_scroll) buffer->scroll_offset = max_scroll;
+}
+
+// The oldest tiles are gone after a shrink, the view may have been in there as well.
+INTERNAL void update_lines_after_shrink(ConsoleBuffer *buffer) {
+    update_lines(buffer);
+    clamp_scroll_offset(buffer);
+
+    update_display_buffer(buffer);
+}
+
+INTERNAL void rebuild_line_index(ConsoleBuffer *buffer) {
+    buffer->lines.size = 0;
+    buffer->first_line = 0;
+
+    mark_lines_dirty(buffer, content_begin(buffer));
+
+    update_line_index(buffer);
+}
+
+INTERNAL ConsoleTile *row_cells(ConsoleScreen *screen, s32 y) {
+    return screen->cells.memory + screen->rows[y].cells;
+}
+
+INTERNAL b32 row_is_blank(ConsoleScreen *screen, s32 y) {
+    return screen->rows[y].generation != screen->generation;
+}
+
+// Number of cells in use, a blank row has none no matter what its stale cells still hold.
+INTERNAL s32 row_used(ConsoleScreen *screen, s32 y) {
+    return row_is_blank(screen, y) ? 0 : screen->rows[y].size;
+}
+
+INTERNAL b32 row_wrapped(ConsoleScreen *screen, s32 y) {
+    return !row_is_blank(screen, y) && screen->rows[y].wrapped;
+}
+
+// Returns the row ready for writing. The stale cells of a blank row are cleared first.
+INTERNAL ConsoleScreenRow *writable_row(ConsoleScreen *screen, s32 y) {
+    ConsoleScreenRow *row = &screen->rows[y];
+
+    if (row->generation != screen->generation) {
+        zero_memory(screen->cells.memory + row->cells, row->size * sizeof(ConsoleTile));
+        row->size       = 0;
+        row->wrapped    = false;
+        row->generation = screen->generation;
+    }
+
+    return row;
+}
+
+// Adds a row that was just written to the ring at start to the line index, so the tiles don't have
+// to be scanned again. Gives up and leaves the rest to update_line_index if the index is already
+// dirty or the row continues a wrapped row that did not fill the screen.
+INTERNAL void index_pushed_row(ConsoleBuffer *buffer, s64 start, s32 size, b32 finished) {
+    s64 count = line_count(buffer);
+    LineInfo *line = count ? get_line(buffer, count - 1) : 0;
+
+    b32 indexed = !buffer->lines_dirty && line && line->start + line->size == start;
+    if (indexed && buffer->line_wrap && line->size) {
+        if (line->size == buffer->screen.size.x) {
+            // NOTE: Same as the scan, a full line only ends here if there are more tiles for the next one.
+            if (size) {
+                LineInfo info = {start, 0};
+                line = append(buffer->lines, info);
+            }
+        } else {
+            indexed = false;
+        }
+    }
+
+    if (!indexed) {
+        mark_lines_dirty(buffer, start);
+        return;
+    }
+
+    line->size += size;
+
+    if (finished) {
+        LineInfo info = {start + size + 1, 0};
+        append(buffer->lines, info);
+    }
+}
+
+// Appends the cells of a row to the scrollback. An unfinished row leaves its line open, so the
+// next row continues it.
+INTERNAL void push_to_scrollback(ConsoleBuffer *buffer, ConsoleTile *cells, s32 size, b32 finished) {
+    s32 count = size + (finished ? 1 : 0);
+    if (count == 0) return;
+
+    s64 start = buffer->tile_end;
+    String range = write_ring(buffer, count * sizeof(ConsoleTile));
+    assert(range.size == count * (s64)sizeof(ConsoleTile));
+
+    ConsoleTile *tiles = (ConsoleTile*)range.data;
+    copy_memory(tiles, cells, size * sizeof(ConsoleTile));
+
+    if (finished) {
+        INIT_STRUCT(&tiles[size]);
+        tiles[size].cp = '\n';
+    }
+
+    index_pushed_row(buffer, start, size, finished);
+}
+
+// NOTE: Only marks the row as blank, see ConsoleScreenRow.generation.
+INTERNAL void clear_row(ConsoleScreen *screen, s32 y) {
+    screen->rows[y].generation = screen->generation - 1;
+}
+
+INTERNAL void reverse_rows(ConsoleScreen *screen, s32 first, s32 last) {
+    while (first < last) {
+        ConsoleScreenRow row = screen->rows[first];
+        screen->rows[first]  = screen->rows[last];
+        screen->rows[last]   = row;
+
+        first += 1;
+        last  -= 1;
+    }
+}
+
+// Rotates the row headers from top to bottom (inclusive) up by amount, the cells stay where they are.
+// NOTE: Rotating with three reversals works in place for any amount. A line feed only ever moves
+//       by one row though, that is a single move.
+INTERNAL void rotate_rows_up(ConsoleScreen *screen, s32 top, s32 bottom, s32 amount) {
+    if (amount == 1) {
+        ConsoleScreenRow row = screen->rows[top];
+        copy_memory(screen->rows.memory + top, screen->rows.memory + top + 1, (bottom - top) * sizeof(ConsoleScreenRow));
+        screen->rows[bottom] = row;
+
+        return;
+    }
+
+    reverse_rows(screen, top, top + amount - 1);
+    reverse_rows(screen, top + amount, bottom);
+    reverse_rows(screen, top, bottom);
+}
+
+// Scrolls the rows from top to bottom up by amount and leaves empty rows at the bottom. Rows that
+// leave the whole screen go into the scrollback if keep_lines is set, else they are dropped.
+INTERNAL void scroll_rows_up(ConsoleBuffer *buffer, s32 top, s32 bottom, s32 amount, b32 keep_lines) {
+    ConsoleScreen *screen = &buffer->screen;
+
+    if (amount > bottom - top + 1) amount = bottom - top + 1;
+    if (amount < 1) return;
+
+    if (keep_lines) {
+        for (s32 y = top; y < top + amount; y += 1) {
+            push_to_scrollback(buffer, row_cells(screen, y), row_used(screen, y), !row_wrapped(screen, y));
+        }
+    }
+
+    rotate_rows_up(screen, top, bottom, amount);
+
+    for (s32 y = bottom - amount + 1; y <= bottom; y += 1) clear_row(screen, y);
+}
+
+INTERNAL void scroll_rows_down(ConsoleBuffer *buffer, s32 top, s32 bottom, s32 amount) {
+    ConsoleScreen *screen = &buffer->screen;
+
+    if (amount > bottom - top + 1) amount = bottom - top + 1;
+    if (amount < 1) return;
+
+    rotate_rows_up(screen, top, bottom, (bottom - top + 1) - amount);
+
+    for (s32 y = top; y < top + amount; y += 1) clear_row(screen, y);
+}
+
+// Only a region that covers the whole screen feeds the scrollback, anything else belongs to
+// a full screen program like a pager with a status line.
+INTERNAL b32 region_is_screen(ConsoleScreen *screen) {
+    return screen->scroll_top == 0 && screen->scroll_bottom == screen->size.y - 1;
+}
+
+INTERNAL void line_feed(ConsoleBuffer *buffer) {
+    ConsoleScreen *screen = &buffer->screen;
+
+    if (screen->cursor.y == screen->scroll_bottom) {
+        scroll_rows_up(buffer, screen->scroll_top, screen->scroll_bottom, 1, region_is_screen(screen));
+    } else if (screen->cursor.y + 1 < screen->size.y) {
+        screen->cursor.y += 1;
+    }
+}
+
+INTERNAL void reverse_line_feed(ConsoleBuffer *buffer) {
+    ConsoleScreen *screen = &buffer->screen;
+
+    if (screen->cursor.y == screen->scroll_top) {
+        scroll_rows_down(buffer, screen->scroll_top, screen->scroll_bottom, 1);
+    } else if (screen->cursor.y > 0) {
+        screen->cursor.y -= 1;
+    }
+}
+
+// Pushes the whole screen into the scrollback, reflows it and pulls the last lines back onto
+// a screen of the new size. The cursor keeps its place in the text.
+INTERNAL void resize_screen(ConsoleBuffer *buffer, V2i size) {
+    ConsoleScreen *screen = &buffer->screen;
+
+    s64 cursor_tile = buffer->tile_end;
+    if (screen->cells.size) {
+        // NOTE: Rows below the cursor only count if something was drawn there.
+        s32 last_row = screen->cursor.y;
+        for (s32 y = last_row + 1; y < screen->size.y; y += 1) {
+            if (row_used(screen, y)) last_row = y;
+        }
+
+        for (s32 y = 0; y <= last_row; y += 1) {
+            s32 row_size = row_used(screen, y);
+            if (y == screen->cursor.y) {
+                // NOTE: The empty cells up to the cursor are kept, so it does not jump back.
+                //       A blank row is cleared first, or text erased by a clear would come back.
+                writable_row(screen, y);
+                if (row_size < screen->cursor.x) row_size = screen->cursor.x;
+                cursor_tile = buffer->tile_end + screen->cursor.x;
+            }
+
+            push_to_scrollback(buffer, row_cells(screen, y), row_size, !row_wrapped(screen, y) && y != last_row);
+        }
+
+        destroy_array(&screen->cells);
+        destroy_array(&screen->rows);
+    }
+
+    screen->size  = size;
+    screen->scroll_top    = 0;
+    screen->scroll_bottom = size.y - 1;
+    screen->cells = ALLOCATE_ARRAY(ConsoleTile, size.x * size.y);
+    screen->rows  = ALLOCATE_ARRAY(ConsoleScreenRow, size.y);
+    zero_memory(screen->cells.memory, screen->cells.size * sizeof(ConsoleTile));
+
+    for (s32 y = 0; y < size.y; y += 1) {
+        ConsoleScreenRow *row = &screen->rows[y];
+        row->cells      = y * size.x;
+        row->size       = 0;
+        row->wrapped    = false;
+        row->generation = screen->generation;
+    }
+
+    rebuild_line_index(buffer);
+
+    s64 lines = line_count(buffer);
+    if (cursor_tile < content_begin(buffer)) cursor_tile = content_begin(buffer);
+
+    s64 cursor_line = lines - 1;
+    while (cursor_line > 0 && get_line(buffer, cursor_line)->start > cursor_tile) cursor_line -= 1;
+
+    // A cursor at the start of a wrapped line stays at the end of the line before it.
+    if (cursor_line > 0 && get_line(buffer, cursor_line)->start == cursor_tile) {
+        LineInfo *previous = get_line(buffer, cursor_line - 1);
+        if (previous->start + previous->size == cursor_tile) cursor_line -= 1;
+    }
+
+    s64 top = lines - size.y;
+    if (top > cursor_line) top = cursor_line;
+    if (top < 0) top = 0;
+
+    s64 end = top + size.y;
+    if (end > lines) end = lines;
+
+    for (s64 i = top; i < end; i += 1) {
+        LineInfo *line = get_line(buffer, i);
+        ConsoleScreenRow *row = &screen->rows[i - top];
+
+        row->size = line->size < size.x ? line->size : size.x;
+        copy_memory(row_cells(screen, i - top), tile_at(buffer, line->start), row->size * sizeof(ConsoleTile));
+
+        row->wrapped = i + 1 < end && get_line(buffer, i + 1)->start == line->start + line->size;
+    }
+
+    s64 cursor_x = cursor_tile - get_line(buffer, cursor_line)->start;
+    if (cursor_x > size.x) cursor_x = size.x;
+
+    screen->cursor.x = cursor_x;
+    screen->cursor.y = cursor_line - top;
+
+    // NOTE: Taking the lines back off the end of the ring only moves its end.
+    s64 pop_start = get_line(buffer, top)->start;
+    s32 popped = (buffer->tile_end - pop_start) * sizeof(ConsoleTile);
+
+    buffer->ring.size -= popped;
+    buffer->ring.end  -= popped;
+    if (buffer->ring.end < 0) buffer->ring.end += buffer->ring.alloc;
+
+    buffer->tile_end = pop_start;
+
+    mark_lines_dirty(buffer, pop_start);
+    update_line_index(buffer);
+
+    // NOTE: Reflowing to more columns leaves fewer lines, the view may have been behind the new start.
+    clamp_scroll_offset(buffer);
+}
+
+V2i screen_size(ConsoleBuffer *buffer) {
+    // NOTE: The last row of the display belongs to the prompt. Until the owner sets a usable
+    //       tile count, output goes to a screen of the default size and is reflowed later.
+    V2i size = {buffer->tile_count.x, buffer->tile_count.y - 1};
+    if (size.x < 1 || size.y < 1) size = {DefaultScreenColumns, DefaultScreenRows};
+
+    return size;
+}
+
+// Returns true when the screen was resized, the scrollback was reflowed in that case as well.
+INTERNAL b32 fit_screen(ConsoleBuffer *buffer) {
+    V2i size = screen_size(buffer);
+
+    if (size.x == buffer->screen.size.x && size.y == buffer->screen.size.y) return false;
+
+    resize_screen(buffer, size);
+
+    if (pipe_reader_running(&buffer->reader)) platform_resize_execution(&buffer->reader.pec, size);
+
+    return true;
+}
+
+void reflow_lines(ConsoleBuffer *buffer) {
+    if (fit_screen(buffer)) return;
+
+    rebuild_line_index(buffer);
+}
+
+INTERNAL void damage_row(ConsoleBuffer *buffer, s32 row) {
+    if (row < 0 || row >= buffer->damaged_rows.size) return;
+
+    buffer->damaged_rows[row] = true;
+    buffer->damaged = true;
+}
+
+void damage_all_rows(ConsoleBuffer *buffer) {
+    FOR (buffer->damaged_rows, row) {
+        *row = true;
+    }
+    buffer->damaged = true;
+}
+
+void clear_damage(ConsoleBuffer *buffer) {
+    if (!buffer->damaged) return;
+
+    FOR (buffer->damaged_rows, row) {
+        *row = false;
+    }
+    buffer->damaged = false;
+}
+
+INTERNAL b32 tiles_are_empty(ConsoleTile *tiles, s64 count) {
+    for (s64 i = 0; i < count; i += 1) {
+        if (tiles[i].cp || tiles[i].style) return false;
+    }
+
+    return true;
+}
+
+// Only rows whose contents differ from what is already in the display buffer are written and damaged.
+void update_display_buffer(ConsoleBuffer *buffer) {
+    update_lines(buffer);
+
+    s32 line_count = buffer->tile_count.y;
+    if (line_count < 1) return;
+
+    s32 columns = buffer->tile_count.x;
+
+    if (columns * line_count != buffer->display_buffer.size || line_count != buffer->damaged_rows.size) {
+        prealloc(buffer->display_buffer, columns * line_count);
+        prealloc(buffer->damaged_rows, line_count);
+
+        FOR (buffer->display_buffer, tile) {
+            INIT_STRUCT(tile);
+        }
+        damage_all_rows(buffer);
+    }
+
+    ConsoleScreen *screen = &buffer->screen;
+
+    // The display shows the end of the scrollback followed by the screen, scroll_offset moves it
+    // back into the scrollback.
+    s64 history = scrollback_line_count(buffer);
+    s64 first   = history - buffer->scroll_offset;
+
+    // NOTE: The last row belongs to the prompt and is never written here.
+    for (s32 row = 0; row < line_count - 1; row += 1) {
+        ConsoleTile *dest = &buffer->display_buffer[row * columns];
+
+        ConsoleTile *source = 0;
+        s64 size = 0;
+
+        s64 index = first + row;
+        if (index >= 0 && index < history) {
+            LineInfo *line = get_line(buffer, index);
+            source = tile_at(buffer, line->start);
+            size   = line->size;
+        } else if (index >= history && index - history < screen->size.y) {
+            source = row_cells(screen, index - history);
+            size   = row_used(screen, index - history);
+        }
+        if (size > columns) size = columns;
+
+        b32 unchanged = (size == 0 || memory_is_equal(dest, source, size * sizeof(ConsoleTile))) && tiles_are_empty(dest + size, columns - size);
+        if (unchanged) continue;
+
+        if (size) copy_memory(dest, source, size * sizeof(ConsoleTile));
+        zero_memory(dest + size, (columns - size) * sizeof(ConsoleTile));
+
+        damage_row(buffer, row);
+    }
+
+    V2i cursor = local_cursor_pos(buffer);
+    if (cursor.x != buffer->display_cursor.x || cursor.y != buffer->display_cursor.y) {
+        damage_row(buffer, buffer->display_cursor.y);
+        damage_row(buffer, cursor.y);
+
+        buffer->display_cursor = cursor;
+    }
+}
+
+// Returns the cells from the cursor to the end of its row. The caller fills them in place and
+// passes the number it used to commit_cells. A pending wrap is resolved first.
+INTERNAL Array<ConsoleTile> writable_cells(ConsoleBuffer *buffer) {
+    ConsoleScreen *screen = &buffer->screen;
+
+    if (screen->cursor.x == screen->size.x) {
+        if (buffer->line_wrap) {
+            writable_row(screen, screen->cursor.y)->wrapped = true;
+            screen->cursor.x = 0;
+
+            line_feed(buffer);
+        } else {
+            // NOTE: Without wrapping the last column is overwritten.
+            screen->cursor.x -= 1;
+        }
+    }
+
+    writable_row(screen, screen->cursor.y);
+
+    Array<ConsoleTile> result = {};
+    result.memory = row_cells(screen, screen->cursor.y) + screen->cursor.x;
+    result.size   = screen->size.x - screen->cursor.x;
+
+    return result;
+}
+
+INTERNAL void commit_cells(ConsoleBuffer *buffer, s32 count) {
+    ConsoleScreen *screen = &buffer->screen;
+    screen->cursor.x += count;
+
+    ConsoleScreenRow *row = &screen->rows[screen->cursor.y];
+    if (row->size < screen->cursor.x) row->size = screen->cursor.x;
+}
+
+// Removes every style that is not referenced anymore, so the slots can be reused.
+INTERNAL void collect_unused_styles(ConsoleBuffer *buffer) {
+    ConsoleStyleTable *table = &buffer->styles;
+
+    Array<u8> used = ALLOCATE_ARRAY(u8, table->styles.size);
+    DEFER(destroy_array(&used));
+    zero_memory(used.memory, used.size);
+
+    used[0] = true;
+    used[buffer->current_style] = true;
+
+    ConsoleTile *content = tile_at(buffer, content_begin(buffer));
+    s64 content_size = buffer->ring.size / sizeof(ConsoleTile);
+    for (s64 i = 0; i < content_size; i += 1) used[content[i].style] = true;
+
+    FOR (buffer->screen.cells, tile) used[tile->style] = true;
+    FOR (buffer->display_buffer, tile) used[tile->style] = true;
+
+    table->free_slots.size = 0;
+    for (s64 i = table->styles.size - 1; i > 0; i -= 1) {
+        if (used[i]) continue;
+
+        remove(&table->lookup, table->styles[i]);
+        append(table->free_slots, (u32)i);
+    }
+}
+
+INTERNAL u32 intern_style(ConsoleBuffer *buffer, ConsoleStyle style) {
+    ConsoleStyleTable *table = &buffer->styles;
+
+    u32 *found = find(&table->lookup, style);
+    if (found) return *found;
+
+    if (table->free_slots.size == 0 && table->styles.size >= ConsoleStyleCollectCount && buffer->tile_end >= table->next_collection) {
+        collect_unused_styles(buffer);
+
+        // NOTE: Everything is still referenced, so the table grows instead. Dropping the colors
+        //       would make the output unreadable.
+        if (table->free_slots.size == 0) table->next_collection = buffer->tile_end + ConsoleStyleCollectCount / 4;
+    }
+
+    u32 index;
+    if (table->free_slots.size) {
+        index = table->free_slots[table->free_slots.size - 1];
+        table->free_slots.size -= 1;
+
+        table->styles[index] = style;
+    } else {
+        index = table->styles.size;
+        append(table->styles, style);
+    }
+
+    insert(&table->lookup, style, index);
+
+    return index;
+}
+
+void update_current_style(ConsoleBuffer *buffer) {
+    ConsoleStyle style = {};
+    style.fg = buffer->current_fg;
+    style.bg = buffer->current_bg;
+
+    style.font_kind = CONSOLE_FONT_REGULAR;
+    if ((buffer->current_tile_flags & CONSOLE_TILE_FLAGS_BOLD_ITALIC) == CONSOLE_TILE_FLAGS_BOLD_ITALIC) {
+        style.font_kind = CONSOLE_FONT_BOLD_ITALIC;
+    } else if (buffer->current_tile_flags & CONSOLE_TILE_FLAG_BOLD) {
+        style.font_kind = CONSOLE_FONT_BOLD;
+    } else if (buffer->current_tile_flags & CONSOLE_TILE_FLAG_ITALIC) {
+        style.font_kind = CONSOLE_FONT_ITALIC;
+    }
+
+    buffer->current_style = intern_style(buffer, style);
+}
+
+INTERNAL void init_styles(ConsoleBuffer *buffer) {
+    ConsoleStyle empty = {};
+    append(buffer->styles.styles, empty);
+    insert(&buffer->styles.lookup, empty, (u32)0);
+
+    update_current_style(buffer);
+}
+
+u32 const DefaultTileFlags = 0;
+
+// Handles the 5;n and 2;r;g;b forms following a 38 or 48. The index is moved past the consumed
+// arguments so the color components are not read as attributes of their own.
+INTERNAL b32 parse_extended_color(EscapeSequence seq, s32 *index, u32 *color) {
+    s32 i = *index;
+    if (i + 1 >= seq.arg_count) return false;
+
+    if (seq.args[i + 1] == 5) {
+        if (i + 2 >= seq.arg_count || seq.args[i + 2] > 255) return false;
+
+        *color = ansi_8bit_color(seq.args[i + 2]);
+        *index = i + 2;
+
+        return true;
+    }
+
+    if (seq.args[i + 1] == 2) {
+        if (i + 4 >= seq.arg_count) return false;
+
+        s32 r = seq.args[i + 2];
+        s32 g = seq.args[i + 3];
+        s32 b = seq.args[i + 4];
+        if (r > 255 || g > 255 || b > 255) return false;
+
+        *color = PACK_RGB(r, g, b);
+        *index = i + 4;
+
+        return true;
+    }
+
+    return false;
+}
+
+INTERNAL void change_buffer_graphics(ConsoleBuffer *buffer, EscapeSequence seq) {
+    for (s32 i = 0; i < seq.arg_count; i += 1) {
+        switch (seq.args[i]) {
+        case ESCAPE_CSI_RESET: {
+           buffer->current_fg = buffer->fg_color;
+           buffer->current_bg = buffer->bg_color;
+           buffer->current_tile_flags = DefaultTileFlags;
+        } break;
+
+        case ESCAPE_CSI_SET_BOLD: buffer->current_tile_flags |= CONSOLE_TILE_FLAG_BOLD; break;
+
+        case ESCAPE_CSI_FOREGROUND: {
+            if (!parse_extended_color(seq, &i, &buffer->current_fg)) {
+                LOG(LOG_ERROR, "Unsupported foreground color sequence.\n");
+            }
+        } break;
+
+        case ESCAPE_CSI_BACKGROUND: {
+            if (!parse_extended_color(seq, &i, &buffer->current_bg)) {
+                LOG(LOG_ERROR, "Unsupported background color sequence.\n");
+            }
+        } break;
+
+        case ESCAPE_CSI_FOREGROUND_BLACK:
+        case ESCAPE_CSI_FOREGROUND_RED:
+        case ESCAPE_CSI_FOREGROUND_GREEN:
+        case ESCAPE_CSI_FOREGROUND_YELLOW:
+        case ESCAPE_CSI_FOREGROUND_BLUE:
+        case ESCAPE_CSI_FOREGROUND_MAGENTA:
+        case ESCAPE_CSI_FOREGROUND_CYAN:
+        case ESCAPE_CSI_FOREGROUND_WHITE:
+        case ESCAPE_CSI_FOREGROUND_BRIGHT_BLACK:
+        case ESCAPE_CSI_FOREGROUND_BRIGHT_RED:
+        case ESCAPE_CSI_FOREGROUND_BRIGHT_GREEN:
+        case ESCAPE_CSI_FOREGROUND_BRIGHT_YELLOW:
+        case ESCAPE_CSI_FOREGROUND_BRIGHT_BLUE:
+        case ESCAPE_CSI_FOREGROUND_BRIGHT_MAGENTA:
+        case ESCAPE_CSI_FOREGROUND_BRIGHT_CYAN:
+        case ESCAPE_CSI_FOREGROUND_BRIGHT_WHITE:
+            buffer->current_fg = ansi_4bit_color(seq.args[i]);
+        break;
+
+        case ESCAPE_CSI_BACKGROUND_BLACK:
+        case ESCAPE_CSI_BACKGROUND_RED:
+        case ESCAPE_CSI_BACKGROUND_GREEN:
+        case ESCAPE_CSI_BACKGROUND_YELLOW:
+        case ESCAPE_CSI_BACKGROUND_BLUE:
+        case ESCAPE_CSI_BACKGROUND_MAGENTA:
+        case ESCAPE_CSI_BACKGROUND_CYAN:
+        case ESCAPE_CSI_BACKGROUND_WHITE:
+        case ESCAPE_CSI_BACKGROUND_BRIGHT_BLACK:
+        case ESCAPE_CSI_BACKGROUND_BRIGHT_RED:
+        case ESCAPE_CSI_BACKGROUND_BRIGHT_GREEN:
+        case ESCAPE_CSI_BACKGROUND_BRIGHT_YELLOW:
+        case ESCAPE_CSI_BACKGROUND_BRIGHT_BLUE:
+        case ESCAPE_CSI_BACKGROUND_BRIGHT_MAGENTA:
+        case ESCAPE_CSI_BACKGROUND_BRIGHT_CYAN:
+        case ESCAPE_CSI_BACKGROUND_BRIGHT_WHITE:
+            buffer->current_bg = ansi_4bit_color(seq.args[i]);
+        break;
+        }
+    }
+
+    update_current_style(buffer);
+}
+
+s32 const TabWidth = 8;
+
+enum CursorMovement {
+    MOVE_UP,
+    MOVE_DOWN,
+    MOVE_LEFT,
+    MOVE_RIGHT,
+};
+// Positions are clamped to the screen, which also drops a pending wrap.
+INTERNAL void set_cursor(ConsoleBuffer *buffer, s32 x, s32 y) {
+    ConsoleScreen *screen = &buffer->screen;
+
+    if (x > screen->size.x - 1) x = screen->size.x - 1;
+    if (x < 0) x = 0;
+    if (y > screen->size.y - 1) y = screen->size.y - 1;
+    if (y < 0) y = 0;
+
+    screen->cursor.x = x;
+    screen->cursor.y = y;
+}
+
+INTERNAL void move_cursor(ConsoleBuffer *buffer, CursorMovement direction, s32 amount) {
+    ConsoleScreen *screen = &buffer->screen;
+    V2i cursor = screen->cursor;
+
+    // NOTE: Inside the scroll region vertical movement stops at its margins.
+    if (direction == MOVE_UP) {
+        s32 limit = cursor.y >= screen->scroll_top ? screen->scroll_top : 0;
+
+        cursor.y -= amount;
+        if (cursor.y < limit) cursor.y = limit;
+    } else if (direction == MOVE_DOWN) {
+        s32 limit = cursor.y <= screen->scroll_bottom ? screen->scroll_bottom : screen->size.y - 1;
+
+        cursor.y += amount;
+        if (cursor.y > limit) cursor.y = limit;
+    } else if (direction == MOVE_LEFT) {
+        // NOTE: A pending wrap counts as the last column.
+        if (cursor.x == screen->size.x) cursor.x -= 1;
+        cursor.x -= amount;
+    } else if (direction == MOVE_RIGHT) {
+        cursor.x += amount;
+    }
+
+    set_cursor(buffer, cursor.x, cursor.y);
+}
+
+// Erased cells keep the background of the current style, like xterm does (background color erase).
+// With the default background they are simply empty, which keeps clearing whole rows lazy.
+INTERNAL b32 erase_keeps_style(ConsoleBuffer *buffer) {
+    return buffer->current_bg != buffer->bg_color;
+}
+
+INTERNAL void fill_erased(ConsoleBuffer *buffer, ConsoleTile *cells, s32 count) {
+    ConsoleTile blank = {0, buffer->current_style};
+    for (s32 i = 0; i < count; i += 1) cells[i] = blank;
+}
+
+// Clears the cells from begin up to end in the row of the cursor.
+INTERNAL void erase_in_row(ConsoleBuffer *buffer, s32 begin, s32 end) {
+    ConsoleScreen *screen = &buffer->screen;
+    if (end > screen->size.x) end = screen->size.x;
+
+    if (erase_keeps_style(buffer)) {
+        if (begin >= end) return;
+
+        ConsoleScreenRow *row = writable_row(screen, screen->cursor.y);
+        fill_erased(buffer, row_cells(screen, screen->cursor.y) + begin, end - begin);
+        if (end > row->size) row->size = end;
+
+        return;
+    }
+
+    if (row_is_blank(screen, screen->cursor.y)) return;
+
+    ConsoleScreenRow *row = &screen->rows[screen->cursor.y];
+    if (end > row->size) end = row->size;
+    if (begin >= end) return;
+
+    zero_memory(row_cells(screen, screen->cursor.y) + begin, (end - begin) * sizeof(ConsoleTile));
+    if (end == row->size) row->size = begin;
+}
+
+// Clears a whole row for ED. See erase_keeps_style, only a colored background has to be written.
+INTERNAL void erase_row(ConsoleBuffer *buffer, s32 y) {
+    ConsoleScreen *screen = &buffer->screen;
+
+    if (!erase_keeps_style(buffer)) {
+        clear_row(screen, y);
+        return;
+    }
+
+    ConsoleScreenRow *row = writable_row(screen, y);
+    fill_erased(buffer, row_cells(screen, y), screen->size.x);
+    row->size    = screen->size.x;
+    row->wrapped = false;
+}
+
+INTERNAL void execute_control(ConsoleBuffer *buffer, u32 c) {
+    ConsoleScreen *screen = &buffer->screen;
+
+    // NOTE: A line feed returns the carriage as well. Files and pipes rarely put a \r in front of it.
+    if (c == '\n') {
+        screen->cursor.x = 0;
+        line_feed(buffer);
+    } else if (c == '\r') {
+        screen->cursor.x = 0;
+    } else if (c == '\t') {
+        if (screen->cursor.x < screen->size.x) {
+            set_cursor(buffer, (screen->cursor.x / TabWidth + 1) * TabWidth, screen->cursor.y);
+        }
+    } else if (c == '\b') {
+        move_cursor(buffer, MOVE_LEFT, 1);
+    }
+
+    // TODO: Bell, vertical tab, form feed, shift in/out, ...
+}
+
+// Sets the scroll region from 1 based rows and moves the cursor home, like DECSTBM.
+INTERNAL void set_scroll_region(ConsoleBuffer *buffer, s32 top, s32 bottom) {
+    ConsoleScreen *screen = &buffer->screen;
+
+    if (bottom > screen->size.y) bottom = screen->size.y;
+    if (top >= bottom) return;
+
+    screen->scroll_top    = top - 1;
+    screen->scroll_bottom = bottom - 1;
+
+    set_cursor(buffer, 0, 0);
+}
+
+// Insert and delete line only work inside the scroll region and return the carriage.
+INTERNAL void insert_lines(ConsoleBuffer *buffer, s32 amount) {
+    ConsoleScreen *screen = &buffer->screen;
+    if (screen->cursor.y < screen->scroll_top || screen->cursor.y > screen->scroll_bottom) return;
+
+    scroll_rows_down(buffer, screen->cursor.y, screen->scroll_bottom, amount);
+    screen->cursor.x = 0;
+}
+
+INTERNAL void delete_lines(ConsoleBuffer *buffer, s32 amount) {
+    ConsoleScreen *screen = &buffer->screen;
+    if (screen->cursor.y < screen->scroll_top || screen->cursor.y > screen->scroll_bottom) return;
+
+    scroll_rows_up(buffer, screen->cursor.y, screen->scroll_bottom, amount, false);
+    screen->cursor.x = 0;
+}
+
+INTERNAL void clear_screen(ConsoleBuffer *buffer) {
+    buffer->screen.generation += 1;
+}
+
+// Forgets the scrollback without touching the ring memory, the tiles in front of tile_end just
+// stop being part of the content.
+INTERNAL void clear_scrollback(ConsoleBuffer *buffer) {
+    buffer->ring.size = 0;
+
+    buffer->lines.size = 0;
+    buffer->first_line = 0;
+    mark_lines_dirty(buffer, buffer->tile_end);
+
+    buffer->scroll_offset = 0;
+
+    // NOTE: A ring that grew for the old history is handed back to the governor. If that fails
+    //       the ring just keeps its size, it is empty either way.
+    if (buffer->ring.alloc > DefaultConsoleBufferSize) {
+        if (!platform_resize_ring_buffer(&buffer->ring, DefaultConsoleBufferSize)) {
+            LOG(LOG_ERROR, "Could not shrink the cleared scrollback.\n");
+        }
+    }
+}
+
+INTERNAL void erase_in_screen(ConsoleBuffer *buffer, s32 mode) {
+    ConsoleScreen *screen = &buffer->screen;
+
+    if (mode == 0) {
+        erase_in_row(buffer, screen->cursor.x, screen->size.x);
+        for (s32 y = screen->cursor.y + 1; y < screen->size.y; y += 1) erase_row(buffer, y);
+    } else if (mode == 1) {
+        for (s32 y = 0; y < screen->cursor.y; y += 1) erase_row(buffer, y);
+        erase_in_row(buffer, 0, screen->cursor.x + 1);
+    } else if (mode == 2) {
+        clear_screen(buffer);
+        if (erase_keeps_style(buffer)) {
+            for (s32 y = 0; y < screen->size.y; y += 1) erase_row(buffer, y);
+        }
+    } else if (mode == 3) {
+        clear_scrollback(buffer);
+    }
+}
+
+// ESC c. The scrollback is kept, like xterm does.
+INTERNAL void reset_console(ConsoleBuffer *buffer) {
+    ConsoleScreen *screen = &buffer->screen;
+
+    buffer->current_fg = buffer->fg_color;
+    buffer->current_bg = buffer->bg_color;
+    buffer->current_tile_flags = DefaultTileFlags;
+    update_current_style(buffer);
+
+    buffer->line_wrap = true;
+
+    screen->scroll_top    = 0;
+    screen->scroll_bottom = screen->size.y - 1;
+
+    clear_screen(buffer);
+    set_cursor(buffer, 0, 0);
+}
+
+// Missing and zero arguments both mean the default.
+INTERNAL s32 sequence_arg(EscapeSequence *seq, s32 index, s32 default_value) {
+    if (index >= seq->arg_count || seq->args[index] == 0) return default_value;
+
+    return seq->args[index];
+}
+
+INTERNAL u32 count_trailing_zeros(u32 mask) {
+    assert(mask);
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// Returns the number of bytes in front of data that can be stored as tiles without going through
+// the parser. These are printable ascii characters and the tab, line feed and carriage return controls.
+INTERNAL s64 plain_run_length(u8 *data, s64 size) {
+    s64 i = 0;
+
+#if defined(THERMAL_SCAN_AVX2) || defined(THERMAL_SCAN_SSE2)
+    // NOTE: The comparison is signed, so everything >= 0x80 counts as smaller than a space
+    //       and ends the run as well.
+    __m128i space_16 = _mm_set1_epi8(0x20);
+    __m128i del_16   = _mm_set1_epi8(0x7F);
+    __m128i tab_16   = _mm_set1_epi8('\t');
+    __m128i lf_16    = _mm_set1_epi8('\n');
+    __m128i cr_16    = _mm_set1_epi8('\r');
+
+#ifdef THERMAL_SCAN_AVX2
+    __m256i space_32 = _mm256_set1_epi8(0x20);
+    __m256i del_32   = _mm256_set1_epi8(0x7F);
+    __m256i tab_32   = _mm256_set1_epi8('\t');
+    __m256i lf_32    = _mm256_set1_epi8('\n');
+    __m256i cr_32    = _mm256_set1_epi8('\r');
+
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256((__m256i*)(data + i));
+
+        __m256i allowed = _mm256_or_si256(_mm256_cmpeq_epi8(v, tab_32), _mm256_or_si256(_mm256_cmpeq_epi8(v, lf_32), _mm256_cmpeq_epi8(v, cr_32)));
+        __m256i control = _mm256_andnot_si256(allowed, _mm256_cmpgt_epi8(space_32, v));
+        __m256i stop    = _mm256_or_si256(control, _mm256_cmpeq_epi8(v, del_32));
+
+        u32 mask = (u32)_mm256_movemask_epi8(stop);
+        if (mask) return i + count_trailing_zeros(mask);
+    }
+#endif
+
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128((__m128i*)(data + i));
+
+        __m128i allowed = _mm_or_si128(_mm_cmpeq_epi8(v, tab_16), _mm_or_si128(_mm_cmpeq_epi8(v, lf_16), _mm_cmpeq_epi8(v, cr_16)));
+        __m128i control = _mm_andnot_si128(allowed, _mm_cmplt_epi8(v, space_16));
+        __m128i stop    = _mm_or_si128(control, _mm_cmpeq_epi8(v, del_16));
+
+        u32 mask = (u32)_mm_movemask_epi8(stop);
+        if (mask) return i + count_trailing_zeros(mask);
+    }
+#endif
+
+    for (; i < size; i += 1) {
+        u8 c = data[i];
+        if (c >= 0x20 && c < 0x7F) continue;
+        if (c == '\t' || c == '\n' || c == '\r') continue;
+
+        break;
+    }
+
+    return i;
+}
+
+// Returns the length of the complete and valid utf8 sequence at the front of data or 0 if there is none.
+// Everything else, including sequences that are split between two reads, is left to the parser.
+INTERNAL s32 utf8_sequence_length(u8 *data, s64 size, u32 *cp) {
+    u8 c = data[0];
+
+    s32 length;
+    u32 min;
+    u32 value;
+    if (c >= 0xC2 && c <= 0xDF) {
+        length = 2;
+        min    = 0x80;
+        value  = c & 0x1F;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        length = 3;
+        min    = 0x800;
+        value  = c & 0x0F;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        length = 4;
+        min    = 0x10000;
+        value  = c & 0x07;
+    } else {
+        return 0;
+    }
+
+    if (length > size) return 0;
+
+    for (s32 i = 1; i < length; i += 1) {
+        if ((data[i] & 0xC0) != 0x80) return 0;
+
+        value = (value << 6) | (data[i] & 0x3F);
+    }
+
+    if (value < min || value > 0x10FFFF || (value >= 0xD800 && value <= 0xDFFF)) return 0;
+
+    *cp = value;
+
+    return length;
+}
+
+// Returns the number of bytes in front of data that can be decoded without the parser.
+INTERNAL s64 text_run_length(u8 *data, s64 size) {
+    s64 i = 0;
+
+    while (i < size) {
+        i += plain_run_length(data + i, size - i);
+        if (i == size) break;
+
+        u32 cp;
+        s32 length = utf8_sequence_length(data + i, size - i, &cp);
+        if (length == 0) break;
+
+        i += length;
+    }
+
+    return i;
+}
+
+INTERNAL ConsoleTile current_tile_template(ConsoleBuffer *buffer) {
+    ConsoleTile tile = {};
+    tile.style = buffer->current_style;
+
+    return tile;
+}
+
+// Writes a single character. A wide one takes two cells and goes to the next row as a whole
+// when it does not fit into the last column.
+INTERNAL void print_character(ConsoleBuffer *buffer, u32 cp) {
+    ConsoleScreen *screen = &buffer->screen;
+
+    ConsoleTile tile = current_tile_template(buffer);
+    tile.cp = cp;
+
+    Array<ConsoleTile> cells = writable_cells(buffer);
+    if (!is_wide_character(cp) || screen->size.x < 2) {
+        cells[0] = tile;
+        commit_cells(buffer, 1);
+
+        return;
+    }
+
+    if (cells.size < 2) {
+        // NOTE: The last column is skipped, the row still continues on the next one. Without
+        //       wrapping the last two columns are overwritten.
+        screen->cursor.x = buffer->line_wrap ? screen->size.x : screen->size.x - 2;
+
+        cells = writable_cells(buffer);
+    }
+
+    cells[0] = tile;
+    cells[1] = tile;
+    cells[1].cp = ConsoleWideSpacer;
+
+    commit_cells(buffer, 2);
+}
+
+void append(ConsoleBuffer *buffer, String str) {
+    Governor.activity += 1;
+    buffer->last_activity = Governor.activity;
+
+    fit_screen(buffer);
+
+    // NOTE: The parser keeps its state between calls, so sequences and utf8 characters
+    //       that are split between two reads are completed with the next call.
+    while (true) {
+        // Plain text is decoded straight into the screen and never touches the parser. This is only
+        // possible when the parser is not in the middle of a sequence or utf8 character.
+        if (buffer->parser.state == ANSI_STATE_GROUND && buffer->parser.utf8_remaining == 0) {
+            s64 run = text_run_length(str.data, str.size);
+
+            if (run) {
+                ConsoleTile tile = current_tile_template(buffer);
+
+                u8 *ptr = str.data;
+                u8 *end = str.data + run;
+                while (ptr < end) {
+                    // NOTE: The only controls inside a run are tabs, line feeds and carriage returns.
+                    if (*ptr < 0x20) {
+                        execute_control(buffer, *ptr);
+                        ptr += 1;
+
+                        continue;
+                    }
+
+                    Array<ConsoleTile> cells = writable_cells(buffer);
+
+                    s32 count = 0;
+                    u32 wide  = 0;
+                    while (count < cells.size && ptr < end && *ptr >= 0x20) {
+                        ConsoleTile *cell = &cells[count];
+                        *cell = tile;
+
+                        if (*ptr < 0x80) {
+                            cell->cp = *ptr;
+                            ptr += 1;
+                        } else {
+                            ptr += utf8_sequence_length(ptr, end - ptr, &cell->cp);
+
+                            // NOTE: Wide characters need a second cell. If it is not in this row
+                            //       print_character moves them to the next one.
+                            if (is_wide_character(cell->cp)) {
+                                if (count + 2 > cells.size) {
+                                    wide  = cell->cp;
+                                    *cell = {};
+
+                                    break;
+                                }
+
+                                count += 1;
+                                cells[count]    = tile;
+                                cells[count].cp = ConsoleWideSpacer;
+                            }
+                        }
+
+                        count += 1;
+                    }
+
+                    commit_cells(buffer, count);
+                    if (wide) print_character(buffer, wide);
+                }
+
+                str = shrink_front(str, run);
+
+                continue;
+            }
+        }
+
+        ANSIEvent event = parse_next(&buffer->parser, &str);
+        if (event.kind == ANSI_EVENT_NONE) break;
+
+        if (event.kind == ANSI_EVENT_EXECUTE) {
+            execute_control(buffer, event.cp);
+        } else if (event.kind == ANSI_EVENT_ESC_DISPATCH) {
+            EscapeSequence *seq = event.seq;
+            if (seq->intermediate_count) continue;
+
+            if (seq->kind == 'D') {
+                line_feed(buffer);
+            } else if (seq->kind == 'E') {
+                buffer->screen.cursor.x = 0;
+                line_feed(buffer);
+            } else if (seq->kind == 'M') {
+                reverse_line_feed(buffer);
+            } else if (seq->kind == 'c') {
+                reset_console(buffer);
+            }
+        } else if (event.kind == ANSI_EVENT_CSI_DISPATCH) {
+            EscapeSequence *seq = event.seq;
+            if (seq->intermediate_count) continue;
+
+            s32 amount = sequence_arg(seq, 0, 1);
+            V2i cursor = buffer->screen.cursor;
+
+            switch (seq->kind) {
+            case 'm': change_buffer_graphics(buffer, *seq); break;
+
+            case 'A': move_cursor(buffer, MOVE_UP, amount);    break;
+            case 'B': move_cursor(buffer, MOVE_DOWN, amount);  break;
+            case 'C': move_cursor(buffer, MOVE_RIGHT, amount); break;
+            case 'D': move_cursor(buffer, MOVE_LEFT, amount);  break;
+
+            case 'G': set_cursor(buffer, amount - 1, cursor.y); break;
+            case 'd': set_cursor(buffer, cursor.x, amount - 1); break;
+            case 'H':
+            case 'f': set_cursor(buffer, sequence_arg(seq, 1, 1) - 1, amount - 1); break;
+
+            case 'L': insert_lines(buffer, amount); break;
+            case 'M': delete_lines(buffer, amount); break;
+
+            case 'S': scroll_rows_up(buffer, buffer->screen.scroll_top, buffer->screen.scroll_bottom, amount, region_is_screen(&buffer->screen)); break;
+            case 'T': {
+                // NOTE: With more arguments this starts a mouse highlight, which is not supported.
+                if (seq->arg_count <= 1) scroll_rows_down(buffer, buffer->screen.scroll_top, buffer->screen.scroll_bottom, amount);
+            } break;
+
+            case 'r': set_scroll_region(buffer, sequence_arg(seq, 0, 1), sequence_arg(seq, 1, buffer->screen.size.y)); break;
+
+            case 'J': erase_in_screen(buffer, sequence_arg(seq, 0, 0)); break;
+            case 'K': {
+                s32 mode = sequence_arg(seq, 0, 0);
+                if (mode == 0) {
+                    erase_in_row(buffer, cursor.x, buffer->screen.size.x);
+                } else if (mode == 1) {
+                    erase_in_row(buffer, 0, cursor.x + 1);
+                } else if (mode == 2) {
+                    erase_in_row(buffer, 0, buffer->screen.size.x);
+                }
+            } break;
+            }
+        } else if (event.kind == ANSI_EVENT_PRINT) {
+            print_character(buffer, event.cp);
+        }
+    }
+
+}
+
+void init(ConsoleBuffer *buffer) {
+    buffer->ring = platform_create_ring_buffer(DefaultConsoleBufferSize);
+    assert(buffer->ring.alloc % sizeof(ConsoleTile) == 0);
+
+    buffer->scrollback = DefaultScrollbackConfig;
+    register_scrollback(buffer);
+
+    buffer->fg_color  = PACK_RGB(210, 210, 210);
+    buffer->bg_color  = 0;
+
+    buffer->current_fg = buffer->fg_color;
+    buffer->current_bg = buffer->bg_color;
+
+    buffer->line_wrap = true;
+
+    init(&buffer->parser);
+    init_styles(buffer);
+}
+
+void destroy(ConsoleBuffer *buffer) {
+    unregister_scrollback(buffer);
+    platform_destroy_ring_buffer(&buffer->ring);
+
+    destroy(buffer->lines);
+    destroy_array(&buffer->screen.cells);
+    destroy_array(&buffer->screen.rows);
+    destroy(buffer->display_buffer);
+    destroy(buffer->damaged_rows);
+    destroy(buffer->command);
+
+    destroy(buffer->styles.styles);
+    destroy(buffer->styles.free_slots);
+    destroy(&buffer->styles.lookup);
+
+    INIT_STRUCT(buffer);
+}
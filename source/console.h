@@ -0,0 +1,232 @@
+#pragma once
+
+#include "definitions.h"
+#include "platform.h"
+#include "string2.h"
+#include "font.h"
+#include "ansi_escape_parser.h"
+#include "hash_table.h"
+#include "pipe_reader.h"
+
+
+u32 const PROMPT_BUFFER_SIZE = 128;
+enum PromtKind {
+    PROMPT_STATIC,
+    PROMPT_UPDATE_EACH_COMMAND,
+    // PROMPT_UPDATE_EACH_FRAME,
+};
+struct PromptBuffer {
+    PromtKind kind;
+    u32 buffer[PROMPT_BUFFER_SIZE];
+    u32 buffer_used;
+
+    String format;
+};
+
+enum {
+    CONSOLE_TILE_FLAG_BOLD   = 0x01,
+    CONSOLE_TILE_FLAG_ITALIC = 0x02,
+
+    CONSOLE_TILE_FLAGS_BOLD_ITALIC = CONSOLE_TILE_FLAG_BOLD | CONSOLE_TILE_FLAG_ITALIC,
+};
+// Most output only uses a handful of color combinations, so tiles only store an index
+// into the style table of their buffer.
+struct ConsoleStyle {
+    u32 fg;
+    u32 bg;
+    u32 font_kind;
+};
+
+inline bool operator!=(ConsoleStyle const &lhs, ConsoleStyle const &rhs) {
+    return lhs.fg != rhs.fg || lhs.bg != rhs.bg || lhs.font_kind != rhs.font_kind;
+}
+
+inline u32 style_hash(ConsoleStyle style) {
+    u32 h = 2166136261u;
+    h = (h ^ style.fg) * 16777619u;
+    h = (h ^ style.bg) * 16777619u;
+    h = (h ^ style.font_kind) * 16777619u;
+
+    return h ^ (h >> 15);
+}
+
+// Index 0 is an all zero style that is always present. It is used for empty cells, like the
+// ones the cursor skipped over or that were erased.
+// Once the table holds this many styles, unreferenced ones are collected before it grows any further.
+u32 const ConsoleStyleCollectCount = 65536;
+struct ConsoleStyleTable {
+    DArray<ConsoleStyle> styles;
+    DArray<u32> free_slots;
+
+    HashTable<ConsoleStyle, u32, u32, style_hash> lookup;
+
+    // When every style is still referenced a collection frees nothing and the table just grows.
+    // The next one is only tried once tile_end reached this, so huge scrollbacks full of 24 bit
+    // colors are not rescanned all the time.
+    s64 next_collection;
+};
+
+struct ConsoleTile {
+    u32 cp;
+    // Index into ConsoleBuffer.styles. A full 32 bits, output with lots of 24 bit colors easily
+    // references more than 65536 styles at once.
+    u32 style;
+};
+
+// A wide character takes two cells, the second one holds this instead of a code point.
+// It is one past the last code point, so it never collides with real text.
+u32 const ConsoleWideSpacer = 0x110000;
+
+// Lines are stored as absolute tile indices. An index keeps counting up when the ring wraps,
+// so a line stays valid as long as its tiles are not overwritten.
+struct LineInfo {
+    s64 start;
+    s64 size;
+};
+
+// The ring starts small and doubles whenever it would start overwriting history, until one
+// of the limits is hit. A limit of 0 means there is none. See set_scrollback to change them.
+struct ScrollbackConfig {
+    s64 max_lines;
+    s64 max_bytes;
+};
+
+// One row of the screen. Rows only point into the cell memory, so scrolling reorders the
+// row headers and never moves the tiles themselves.
+struct ConsoleScreenRow {
+    s32 cells;   // Index of the first cell in ConsoleScreen.cells.
+    s32 size;    // Columns up to and including the last written one, the cells after it are empty.
+    b32 wrapped; // The line continues on the next row.
+
+    // The row is blank when this is not the generation of the screen. Its old cells are only
+    // cleared once it gets written again, so clearing costs the same no matter what is on screen.
+    u32 generation;
+};
+
+// The fixed size grid the cursor lives in. It covers the visible area, only rows that scroll
+// off its top are moved into the scrollback ring.
+struct ConsoleScreen {
+    Array<ConsoleTile> cells;
+    Array<ConsoleScreenRow> rows;
+    V2i size;
+
+    V2i cursor; // .x is equal to size.x after the last column was written and the wrap is pending.
+
+    // Rows that scroll, both inclusive. Set with DECSTBM, the whole screen by default.
+    s32 scroll_top;
+    s32 scroll_bottom;
+
+    u32 generation; // Bumping it blanks every row at once.
+};
+
+struct ConsoleBuffer {
+    PlatformRingBuffer ring;
+
+    ScrollbackConfig scrollback;
+    u64 last_activity; // See ScrollbackGovernor.
+
+    s64 tile_end; // Absolute index of the tile after the last written one.
+
+    ConsoleScreen screen;
+
+    s32 scroll_offset; // Lines of scrollback shown above the screen.
+
+    DArray<LineInfo> lines;
+    s64 first_line; // Lines in front of this were overwritten by the ring and get compacted lazily.
+
+    b32 lines_dirty;
+    s64 lines_dirty_from; // Absolute tile index of the first change since the last update_lines.
+                          // Rows that scroll into the ring are indexed right away while it is clean.
+
+    DArray<ConsoleTile> display_buffer;
+
+    // Rows of the display buffer that changed since the last clear_damage, so a view only has to
+    // rebuild those. The cursor counts as part of its row.
+    DArray<b8> damaged_rows;
+    b32 damaged;
+    V2i display_cursor;
+
+    DArray<u32> command;
+    s32 cursor_pos;
+    Array<String32> history;
+    
+    PromptBuffer prompt;
+
+    ANSIParser parser;
+
+    ConsoleFont *font;
+
+    u32 fg_color;
+    u32 bg_color;
+
+    u32 current_tile_flags;
+    u32 current_fg;
+    u32 current_bg;
+
+    ConsoleStyleTable styles;
+    u32 current_style; // Interned from the three above, see update_current_style.
+
+    b32 line_wrap;
+
+    V2i tile_count;
+
+    PipeReader reader;
+};
+
+// Keeps the scrollback memory of all buffers under a common budget. When a buffer wants to grow
+// past it, the buffers that were written to least recently are shrunk first, which drops their
+// oldest history.
+struct ScrollbackGovernor {
+    s64 budget;
+    u64 activity; // Counts up with every append.
+
+    DArray<ConsoleBuffer*> buffers;
+};
+
+// Reads a limit like "10000 lines" or "64 mb". Only the given limit is set, the other one is 0.
+b32 parse_scrollback_config(String text, ScrollbackConfig *config);
+// A ring that is bigger than the new byte limit is shrunk, its oldest history is lost.
+void set_scrollback(ConsoleBuffer *buffer, ScrollbackConfig config);
+
+void register_scrollback(ConsoleBuffer *buffer);
+void unregister_scrollback(ConsoleBuffer *buffer);
+s64 scrollback_memory(ConsoleBuffer *buffer);
+
+
+V2i local_cursor_pos(ConsoleBuffer *buffer);
+
+inline ConsoleStyle *get_style(ConsoleBuffer *buffer, u32 index) {
+    return &buffer->styles.styles[index];
+}
+
+s64 line_count(ConsoleBuffer *buffer);
+LineInfo *get_line(ConsoleBuffer *buffer, s64 index);
+Array<ConsoleTile> line_tiles(ConsoleBuffer *buffer, LineInfo *info);
+// Lines above the screen, this is how far the view can scroll back.
+s64 scrollback_line_count(ConsoleBuffer *buffer);
+
+// Only rescans the lines touched since the last call.
+void update_lines(ConsoleBuffer *buffer);
+// Rebuilds the whole line index. Needed when the wrapping width or mode changes. A new tile_count
+// also resizes the screen, its rows are reflowed together with the scrollback.
+void reflow_lines(ConsoleBuffer *buffer);
+// Columns and rows the screen has for the current tile_count, this is what programs should be told.
+V2i screen_size(ConsoleBuffer *buffer);
+// Brings the line index up to date and copies the visible rows into display_buffer. append leaves
+// both alone, so call this once per frame no matter how much output came in.
+void update_display_buffer(ConsoleBuffer *buffer);
+
+// Marks every row, e.g. after the font or the view changed.
+void damage_all_rows(ConsoleBuffer *buffer);
+void clear_damage(ConsoleBuffer *buffer);
+
+// Sets up an empty buffer with the default scrollback and colors. The font and the
+// tile count are left to the owner.
+void init(ConsoleBuffer *buffer);
+void destroy(ConsoleBuffer *buffer);
+
+// Feeds program output through the escape parser onto the screen. See update_display_buffer.
+void append(ConsoleBuffer *buffer, String str);
+
+// Needs to be called after current_fg, current_bg or current_tile_flags were changed directly.
+void update_current_style(ConsoleBuffer *buffer);
@@ -6,7 +6,7 @@
 
 #if defined(WIN32) || defined(_WIN32)
 #define OS_WINDOWS
-#elif defined(linux)
+#elif defined(linux) || defined(__linux__)
 #define OS_LINUX
 #else
 #error "Platform not supported"
@@ -111,7 +111,7 @@ struct String {
 	}
 
         //NOTE: we never touch a reference and always copy before a change so this cast should be fine
-	constexpr String(char const *str)
+	String(char const *str)
             : data((u8*)str), size(c_string_length(str)) {}
 
 	String &operator=(char const *str) {
@@ -231,6 +231,13 @@ struct V2i {
     };
 };
 
+struct Rect2i {
+    s32 x;
+    s32 y;
+    s32 width;
+    s32 height;
+};
+
 struct M3 {
     r32 value[9];
 };
@@ -4,6 +4,7 @@
 #include "io.h"
 
 #include "platform.h"
+#include "atomic.h"
 
 
 #define STB_TRUETYPE_IMPLEMENTATION
@@ -11,100 +12,71 @@
 #include "stb_truetype.h"
 
 
-INTERNAL GlyphInfo *font_add_glyph(Font *font, u32 cp, u32 mapping = 0) {
-    if (font->tile_count == font->tile_max) {
-        // TODO: path for when the cache is full
-    } else {
-        r32 tile_x = (font->tile_count % font->glyphs_per_line) * font->tile_width;
-        r32 tile_y = (u32)(font->tile_count / font->glyphs_per_line) * font->tile_height;
-
-        int glyph = stbtt_FindGlyphIndex(&font->stb_info, cp);
-        if (glyph == 0) return get_glyph(font, '?'); // TODO: proper replacement character
-
-        int x0, x1, y0, y1;
-        stbtt_GetGlyphBitmapBox(&font->stb_info, glyph, font->scale, font->scale, &x0, &y0, &x1, &y1);
+INTERNAL GlyphInfo *font_add_glyph(Font *font, u32 cp) {
+    ConsoleFont *shared = font->atlas_font;
+    STBFont *stb = &shared->font_data[CONSOLE_FONT_REGULAR];
 
-        s32 height = (y1 - y0);
-        s32 width = (x1 - x0);
+    ConsoleGlyphInfo *cell = get_glyph(shared, CONSOLE_FONT_REGULAR, cp);
 
-        int advance_width, lsb;
-        stbtt_GetGlyphHMetrics(&font->stb_info, glyph, &advance_width, &lsb);
-
-        r32 lsb_tmp = lsb * font->scale;
-
-        s32 y_adjust = (s32)font->ascent + y0;
-        s32 pos = (s32)(((tile_y + y_adjust) * FONT_ATLAS_DIMENSION) + tile_x + lsb_tmp);
-        stbtt_MakeGlyphBitmap(&font->stb_info, &font->atlas[pos], width, height, FONT_ATLAS_DIMENSION, font->scale, font->scale, glyph);
-
-        GlyphInfo info;
+    int advance_width, lsb;
+    stbtt_GetCodepointHMetrics(&stb->info, cp, &advance_width, &lsb);
 
-        info.advance = advance_width * font->scale;
-        info.x0 = lsb_tmp;
-        info.y0 = (r32)y0;
-        info.x1 = info.x0 + width;
-        info.y1 = info.y0 + height;
-        info.u0 = tile_x / FONT_ATLAS_DIMENSION;
-        info.v0 = tile_y / FONT_ATLAS_DIMENSION;
-        info.u1 = (tile_x + font->tile_width)  / FONT_ATLAS_DIMENSION;
-        info.v1 = (tile_y + font->tile_height) / FONT_ATLAS_DIMENSION;
+    // NOTE: The quad covers the whole cell, the glyph is already placed inside of it.
+    GlyphInfo info;
 
-        font->tile_count += 1;
+    info.advance = advance_width * stb->scale;
+    info.x0 = 0.0f;
+    info.y0 = -font->ascent;
+    info.x1 = font->tile_width;
+    info.y1 = font->tile_height - font->ascent;
+    info.u0 = cell->offset_in_atlas.x * FONT_ATLAS_RATIO;
+    info.v0 = cell->offset_in_atlas.y * FONT_ATLAS_RATIO;
+    info.u1 = (cell->offset_in_atlas.x + font->tile_width)  * FONT_ATLAS_RATIO;
+    info.v1 = (cell->offset_in_atlas.y + font->tile_height) * FONT_ATLAS_RATIO;
 
-        font->is_dirty = true;
+    info.slot = cell->slot;
+    info.key  = shared->slots[cell->slot].key;
 
-        if (mapping != 0) cp = mapping;
-        return insert(&font->glyph_table, cp, info);
-    }
-    return 0;
+    return insert(&font->glyph_table, cp, info);
 }
 
-void init(Font *font, r32 height, String font_data) {
-    font->data = font_data;
-    stbtt_InitFont(&font->stb_info, font_data.data, stbtt_GetFontOffsetForIndex(font_data.data, 0));
-    font->scale = stbtt_ScaleForPixelHeight(&font->stb_info, height);
+void init(Font *font, ConsoleFont *atlas_font) {
+    font->atlas_font = atlas_font;
+
+    STBFont *stb = &atlas_font->font_data[CONSOLE_FONT_REGULAR];
 
     int ascent, descent, line_gap;
-    stbtt_GetFontVMetrics(&font->stb_info, &ascent, &descent, &line_gap);
+    stbtt_GetFontVMetrics(&stb->info, &ascent, &descent, &line_gap);
 
-    font->ascent = (ascent * font->scale);
-    r32 descent_tmp  = (descent * font->scale);
-    r32 line_gap_tmp = (line_gap * font->scale);
+    font->ascent = (ascent * stb->scale);
+    r32 descent_tmp  = (descent * stb->scale);
+    r32 line_gap_tmp = (line_gap * stb->scale);
 
     font->line_advance = font->ascent - descent_tmp + line_gap_tmp;
 
-    int x0, y0, x1, y1;
-    stbtt_GetFontBoundingBox(&font->stb_info, &x0, &y0, &x1, &y1);
-
-    int advance_width, lsb;
-    stbtt_GetCodepointHMetrics(&font->stb_info, 'M', &advance_width, &lsb);
-
-    // TODO: I really don't know if this is correct... but the font bounding box is too large and looks ugly.
-    font->tile_width  = ceil(advance_width * font->scale);
-    font->tile_height = ceil(font->ascent - descent_tmp);
-
-    font->glyphs_per_line = (s32)(FONT_ATLAS_DIMENSION / font->tile_width);
-    font->tile_max = font->glyphs_per_line * (s32)(FONT_ATLAS_DIMENSION / font->tile_height);
-
-    font->atlas = allocate_string(FONT_ATLAS_DIMENSION * FONT_ATLAS_DIMENSION);
+    font->tile_width  = (r32)atlas_font->glyph_width;
+    font->tile_height = (r32)atlas_font->glyph_height;
 
     init(&font->glyph_table, 1024);
-
-    // TODO: proper loading of needed characters
-    for (s32 i = 20; i < 128; i += 1) {
-        font_add_glyph(font, i);
-    }
-    font_add_glyph(font, 0x5E, 0x1B);
 }
 
 void destroy(Font *font) {
-    destroy_string(&font->atlas);
     destroy(&font->glyph_table);
 }
 
 GlyphInfo *get_glyph(Font *font, u32 cp) {
+    ConsoleFont *shared = font->atlas_font;
+
+    // NOTE: The cell can be evicted by the console font, the glyph is looked up again then.
+    //       A lookup keeps the cell pinned for the current frame like console glyphs.
     GlyphInfo *info = find(&font->glyph_table, cp);
-    if (!info) info = font_add_glyph(font, cp);
-    return info;
+    if (info && info->slot && shared->slots[info->slot].key == info->key) {
+        touch_glyph_slot(shared, info->slot);
+
+        return info;
+    }
+
+    return font_add_glyph(font, cp);
 }
 
 r32 text_width(Font *font, String text) {
@@ -147,73 +119,355 @@ V2 font_text_metrics(Font *font, String text) {
 }
 
 
-INTERNAL ConsoleGlyphInfo *font_add_glyph(ConsoleFont *font, u32 kind, u32 cp, u32 mapping = 0);
+INTERNAL void mark_atlas_dirty(ConsoleFont *font, Rect2i region) {
+    if (region.x < 0) {
+        region.width += region.x;
+        region.x = 0;
+    }
+    if (region.y < 0) {
+        region.height += region.y;
+        region.y = 0;
+    }
+    if (region.x + region.width  > FONT_ATLAS_DIMENSION) region.width  = FONT_ATLAS_DIMENSION - region.x;
+    if (region.y + region.height > FONT_ATLAS_DIMENSION) region.height = FONT_ATLAS_DIMENSION - region.y;
+    if (region.width <= 0 || region.height <= 0) return;
+
+    font->is_dirty = true;
+
+    Rect2i *previous = last(font->dirty_regions);
+    if (previous && previous->y == region.y && previous->height == region.height &&
+        previous->x <= region.x && region.x <= previous->x + previous->width) {
+        s32 right = region.x + region.width;
+        if (right > previous->x + previous->width) previous->width = right - previous->x;
+
+        return;
+    }
+
+    append(font->dirty_regions, region, font->allocator);
+}
+
+void clear_atlas_changes(ConsoleFont *font) {
+    font->dirty_regions.size = 0;
+    font->is_dirty = false;
+}
+
+INTERNAL V2i slot_offset(ConsoleFont *font, s32 slot) {
+    V2i offset = {(slot % font->glyphs_per_line) * font->glyph_width, (slot / font->glyphs_per_line) * font->glyph_height};
+
+    return offset;
+}
+
+INTERNAL void unlink_slot(ConsoleFont *font, s32 index) {
+    ConsoleGlyphSlot *slot = &font->slots[index];
+    ConsoleGlyphShelves *shelves = &font->shelves[slot->width - 1];
+
+    if (slot->newer) font->slots[slot->newer].older = slot->older;
+    else             shelves->most_recent = slot->older;
+
+    if (slot->older) font->slots[slot->older].newer = slot->newer;
+    else             shelves->least_recent = slot->newer;
+
+    slot->newer = 0;
+    slot->older = 0;
+}
+
+INTERNAL void make_most_recent(ConsoleFont *font, s32 index) {
+    ConsoleGlyphSlot *slot = &font->slots[index];
+    ConsoleGlyphShelves *shelves = &font->shelves[slot->width - 1];
+    slot->last_used_frame = font->frame;
+
+    if (shelves->most_recent == index) return;
+    if (slot->newer || slot->older || shelves->least_recent == index) unlink_slot(font, index);
+
+    slot->older = shelves->most_recent;
+    if (shelves->most_recent) font->slots[shelves->most_recent].newer = index;
+    shelves->most_recent = index;
+
+    if (shelves->least_recent == 0) shelves->least_recent = index;
+}
+
+// Takes the next free slot of the width, a new shelf is started when the current one is full.
+// Returns 0 if there is no room left.
+INTERNAL s32 take_free_slot(ConsoleFont *font, s32 width) {
+    ConsoleGlyphShelves *shelves = &font->shelves[width - 1];
+
+    if (shelves->shelf < 0 || shelves->fill + width > font->glyphs_per_line) {
+        if (font->shelves_used == font->shelf_count) return 0;
 
-ConsoleGlyphInfo *get_glyph(ConsoleFont *font, u32 kind, u32 cp) {
-    ConsoleGlyphInfo *info = find(&font->glyph_table, cp);
-    if (!info || !info->loaded[kind]) info = font_add_glyph(font, kind, cp);
+        shelves->shelf = font->shelves_used;
+        shelves->fill  = 0;
+        font->shelves_used += 1;
+    }
+
+    s32 index = shelves->shelf * font->glyphs_per_line + shelves->fill;
+    shelves->fill   += width;
+    shelves->glyphs += 1;
 
-    return info;
+    font->slots[index].width = (u8)width;
+
+    return index;
 }
 
-INTERNAL ConsoleGlyphInfo *font_add_glyph(ConsoleFont *font, u32 kind, u32 cp, u32 mapping) {
-    u32 glyph_count = font->glyph_table.buckets;
-    if (glyph_count == font->max_glyphs) {
-        // TODO: path for when the cache is full
+// Returns 0 if there is no free slot of the width and every glyph of it is pinned, or evict is not set.
+INTERNAL s32 allocate_slot(ConsoleFont *font, s32 width, b32 evict) {
+    s32 index = take_free_slot(font, width);
+    if (index || !evict) return index;
+
+    index = font->shelves[width - 1].least_recent;
+    if (index == 0 || font->slots[index].last_used_frame == font->frame) return 0;
+
+    unlink_slot(font, index);
+    font->evictions += 1;
+
+    u32 key  = font->slots[index].key;
+    u32 kind = key >> 24;
+    u32 cp   = key & 0xFFFFFF;
+    if (cp < ConsoleDirectGlyphCount) {
+        INIT_STRUCT(&font->direct_glyphs[kind][cp]);
     } else {
-        STBFont *stb = &font->font_data[kind];
+        remove(&font->glyph_table, key);
+    }
+    font->slots[index].in_cache_file = false;
+
+    // The old bitmap has to go, the new one may not cover all of its pixels. The cleared cell is
+    // uploaded as well, a queued glyph shows up empty until it is rasterized and not as the old one.
+    V2i offset = slot_offset(font, index);
+    s32 pixel_width = width * font->glyph_width;
+    for (s32 y = 0; y < font->glyph_height; y += 1) {
+        zero_memory(&font->atlas[(offset.y + y) * FONT_ATLAS_DIMENSION + offset.x], pixel_width);
+    }
+    mark_atlas_dirty(font, {offset.x, offset.y, pixel_width, font->glyph_height});
 
-        int glyph = stbtt_FindGlyphIndex(&stb->info, cp);
-        if (glyph == 0) return get_glyph(font, kind, '?'); // TODO: proper replacement character
+    return index;
+}
 
-        int x0, x1, y0, y1;
-        stbtt_GetGlyphBitmapBox(&stb->info, glyph, stb->scale, stb->scale, &x0, &y0, &x1, &y1);
+// NOTE: The list is ordered by the frame a glyph was last used in, the order within a frame doesn't
+//       matter. So a glyph is only moved once per frame, most lookups end at the comparison.
+void touch_glyph_slot(ConsoleFont *font, s32 slot) {
+    if (font->slots[slot].last_used_frame == font->frame) return;
+
+    make_most_recent(font, slot);
+}
+
+INTERNAL void load_font_style(STBFont *stb, r32 font_height) {
+    u8 *data = stb->file.content.data;
+
+    stbtt_InitFont(&stb->info, data, stbtt_GetFontOffsetForIndex(data, 0));
+    stb->scale = stbtt_ScaleForPixelHeight(&stb->info, font_height);
+
+    int unscaled_ascent, unscaled_descent, unscaled_line_gap;
+    stbtt_GetFontVMetrics(&stb->info, &unscaled_ascent, &unscaled_descent, &unscaled_line_gap);
 
-        s32 height = (y1 - y0);
-        s32 width  = (x1 - x0);
+    stb->ascent  = unscaled_ascent * stb->scale;
+    stb->descent = unscaled_descent * stb->scale;
 
-        int unscaled_advance_width, unscaled_lsb;
-        stbtt_GetGlyphHMetrics(&stb->info, glyph, &unscaled_advance_width, &unscaled_lsb);
+    stb->loaded = true;
+}
+
+// Styles without a font file are drawn with the regular one.
+INTERNAL STBFont *font_style(ConsoleFont *font, u32 kind) {
+    STBFont *stb = &font->font_data[kind];
+    if (stb->file.content.size == 0) stb = &font->font_data[CONSOLE_FONT_REGULAR];
+
+    if (!stb->loaded) load_font_style(stb, font->font_height);
+
+    return stb;
+}
+
+// How far the glyph reaches to the right, measured from the left edge of its cell.
+INTERNAL s32 glyph_right_edge(STBFont *stb, s32 glyph) {
+    int x0, x1, y0, y1;
+    stbtt_GetGlyphBitmapBox(&stb->info, glyph, stb->scale, stb->scale, &x0, &y0, &x1, &y1);
+
+    int unscaled_advance_width, unscaled_lsb;
+    stbtt_GetGlyphHMetrics(&stb->info, glyph, &unscaled_advance_width, &unscaled_lsb);
+
+    return (s32)(unscaled_lsb * stb->scale) + (x1 - x0);
+}
+
+// NOTE: A glyph only gets a second cell if it sticks out by more than a quarter of a cell,
+//       a pixel of overhang like on italic letters is cut off instead.
+INTERNAL s32 glyph_cell_width(ConsoleFont *font, STBFont *stb, s32 glyph) {
+    s32 right = glyph_right_edge(stb, glyph);
+
+    return right > font->glyph_width + font->glyph_width / 4 ? ConsoleMaxGlyphWidth : 1;
+}
+
+// Draws the glyph into a tile that is one cell high and width cells wide.
+// NOTE: Parts that stick out of the tile are cut off, they would land in the cell of another glyph.
+INTERNAL void rasterize_glyph(ConsoleFont *font, STBFont *stb, s32 glyph, s32 width, u8 *tile, s32 stride) {
+    s32 tile_width = width * font->glyph_width;
+
+    int x0, x1, y0, y1;
+    stbtt_GetGlyphBitmapBox(&stb->info, glyph, stb->scale, stb->scale, &x0, &y0, &x1, &y1);
+
+    s32 height    = (y1 - y0);
+    s32 box_width = (x1 - x0);
+
+    int unscaled_advance_width, unscaled_lsb;
+    stbtt_GetGlyphHMetrics(&stb->info, glyph, &unscaled_advance_width, &unscaled_lsb);
 
-        r32 lsb = unscaled_lsb * stb->scale;
-        r32 y_adjust = stb->ascent + y0;
+    s32 x = (s32)(unscaled_lsb * stb->scale);
+    s32 y = (s32)(stb->ascent + y0);
 
-        s32 x = font->next_free_glyph.x + (s32)lsb;
-        s32 y = font->next_free_glyph.y + (s32)y_adjust;
-        s32 pos = (y * FONT_ATLAS_DIMENSION) + x;
-        stbtt_MakeGlyphBitmap(&stb->info, &font->atlas[pos], width, height, FONT_ATLAS_DIMENSION, stb->scale, stb->scale, glyph);
+    if (x >= 0 && y >= 0 && x + box_width <= tile_width && y + height <= font->glyph_height) {
+        stbtt_MakeGlyphBitmap(&stb->info, tile + y * stride + x, box_width, height, stride, stb->scale, stb->scale, glyph);
+        return;
+    }
+
+    int bitmap_width, bitmap_height;
+    u8 *bitmap = stbtt_GetGlyphBitmap(&stb->info, stb->scale, stb->scale, glyph, &bitmap_width, &bitmap_height, 0, 0);
+    if (!bitmap) return;
 
-        V2i offset_in_atlas = font->next_free_glyph;
+    for (s32 row = 0; row < bitmap_height; row += 1) {
+        s32 tile_y = y + row;
+        if (tile_y < 0 || tile_y >= font->glyph_height) continue;
 
-        font->next_free_glyph.x += font->glyph_width;
-        if (font->next_free_glyph.x > FONT_ATLAS_DIMENSION) {
-            font->next_free_glyph.x  = 0;
-            font->next_free_glyph.y += font->glyph_height;
+        for (s32 column = 0; column < bitmap_width; column += 1) {
+            s32 tile_x = x + column;
+            if (tile_x < 0 || tile_x >= tile_width) continue;
+
+            tile[tile_y * stride + tile_x] = bitmap[row * bitmap_width + column];
         }
+    }
+
+    stbtt_FreeBitmap(bitmap, 0);
+}
+
+INTERNAL ConsoleGlyphInfo *register_glyph(ConsoleFont *font, u32 key, s32 slot) {
+    font->slots[slot].key = key;
+    make_most_recent(font, slot);
+
+    ConsoleGlyphInfo info = {};
+    info.offset_in_atlas = slot_offset(font, slot);
+    info.slot  = slot;
+    info.width = font->slots[slot].width;
 
-        font->is_dirty = true;
+    u32 kind = key >> 24;
+    u32 cp   = key & 0xFFFFFF;
+    if (cp < ConsoleDirectGlyphCount) {
+        font->direct_glyphs[kind][cp] = info;
+        return &font->direct_glyphs[kind][cp];
+    }
+
+    return insert(&font->glyph_table, key, info);
+}
+
+INTERNAL b32 glyph_loaded(ConsoleFont *font, u32 key) {
+    u32 kind = key >> 24;
+    u32 cp   = key & 0xFFFFFF;
+    if (cp < ConsoleDirectGlyphCount) return font->direct_glyphs[kind][cp].slot != 0;
 
-        if (mapping != 0) cp = mapping;
+    return find(&font->glyph_table, key) != 0;
+}
+
+INTERNAL GlyphWorker *find_free_worker(ConsoleFont *font) {
+    for (s32 i = 0; i < font->workers.size; i += 1) {
+        s32 index = (font->next_worker + i) % font->workers.size;
+        GlyphWorker *worker = &font->workers[index];
 
-        ConsoleGlyphInfo *result = find(&font->glyph_table, cp);
-        if (result) {
-            result->offset_in_atlas[kind] = offset_in_atlas;
-            result->loaded[kind] = true;
-        } else {
-            ConsoleGlyphInfo info = {};
-            info.offset_in_atlas[kind] = offset_in_atlas;
-            info.loaded[kind] = true;
+        if (worker->submitted - worker->applied < GlyphWorkerCapacity) {
+            font->next_worker = (index + 1) % font->workers.size;
 
-            result = insert(&font->glyph_table, cp, info);
+            return worker;
         }
+    }
+
+    return 0;
+}
+
+INTERNAL void queue_glyph(GlyphWorker *worker, GlyphJob job) {
+    s64 submitted = worker->submitted;
+
+    worker->jobs[submitted & (GlyphWorkerCapacity - 1)] = job;
+    atomic_store_release(&worker->submitted, submitted + 1);
+
+    platform_signal_event(&worker->work_available);
+}
+
+// With background set the glyph is only added if a worker has room for it, 0 is returned otherwise.
+INTERNAL ConsoleGlyphInfo *add_glyph(ConsoleFont *font, u32 kind, u32 cp, u32 mapping, b32 background) {
+    STBFont *stb = font_style(font, kind);
+
+    int glyph = stbtt_FindGlyphIndex(&stb->info, cp);
+    if (glyph == 0) return background ? 0 : get_glyph(font, kind, '?'); // TODO: proper replacement character
+
+    // NOTE: Without a free worker the glyph is rasterized right here.
+    GlyphWorker *worker = find_free_worker(font);
+    if (background && !worker) return 0;
+
+    // NOTE: Background glyphs never evict anything. If there is no room for a wide glyph it is
+    //       cut down to one cell, which is still better than not drawing it.
+    s32 width = glyph_cell_width(font, stb, glyph);
+    s32 slot  = allocate_slot(font, width, !background);
+    if (slot == 0 && width > 1) {
+        width = 1;
+        slot  = allocate_slot(font, width, !background);
+    }
+    if (slot == 0) return background ? 0 : &font->blank_glyph;
+
+    if (mapping != 0) cp = mapping;
+    u32 key = console_glyph_key(kind, cp);
+
+    V2i offset_in_atlas = slot_offset(font, slot);
+
+    if (worker) {
+        queue_glyph(worker, {key, slot, width, stb, glyph});
+    } else {
+        rasterize_glyph(font, stb, glyph, width, &font->atlas[offset_in_atlas.y * FONT_ATLAS_DIMENSION + offset_in_atlas.x], FONT_ATLAS_DIMENSION);
+        mark_atlas_dirty(font, {offset_in_atlas.x, offset_in_atlas.y, width * font->glyph_width, font->glyph_height});
+    }
 
-        return result;
+    return register_glyph(font, key, slot);
+}
+
+ConsoleGlyphInfo *font_add_glyph(ConsoleFont *font, u32 kind, u32 cp, u32 mapping) {
+    font->misses += 1;
+
+    return add_glyph(font, kind, cp, mapping, false);
+}
+
+void next_font_frame(ConsoleFont *font) {
+    font->frame += 1;
+}
+
+// Returns 0 if the font has no such table.
+INTERNAL u8 *find_font_table(String ttf, char const *tag) {
+    if (ttf.size < 12) return 0;
+
+    s32 table_count = (ttf.data[4] << 8) | ttf.data[5];
+    for (s32 i = 0; i < table_count; i += 1) {
+        s64 record = 12 + i * 16;
+        if (record + 16 > ttf.size) return 0;
+
+        u8 *entry = ttf.data + record;
+        if (entry[0] != tag[0] || entry[1] != tag[1] || entry[2] != tag[2] || entry[3] != tag[3]) continue;
+
+        u32 offset = ((u32)entry[8] << 24) | ((u32)entry[9] << 16) | ((u32)entry[10] << 8) | entry[11];
+        if (offset >= ttf.size) return 0;
+
+        return ttf.data + offset;
     }
+
     return 0;
 }
 
+// FNV-1a
+INTERNAL u64 hash_bytes(u64 hash, void const *data, s64 size) {
+    if (hash == 0) hash = 0xcbf29ce484222325;
+
+    u8 const *bytes = (u8 const*)data;
+    for (s64 i = 0; i < size; i += 1) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3;
+    }
+
+    return hash;
+}
+
 void init(ConsoleFont *font, r32 font_height, String font_dir, String font_family, Allocator alloc) {
-    font->allocator = alloc;
+    font->allocator   = alloc;
+    font->font_height = font_height;
     Array<String> fonts = platform_directory_listing(font_dir);
 
     // TODO: This is not really correct. I think the name of the type face is stored inside the font and
@@ -227,27 +481,25 @@ void init(ConsoleFont *font, r32 font_height, String font_dir, String font_famil
     }
 
     FOR (family, file) {
-        stbtt_fontinfo stb = {};
-
-        u32 status;
-        String ttf = read_entire_file(t_format("%S/%S", font_dir, *file), &status, font->allocator);
-        if (status != READ_ENTIRE_FILE_OK) {
-            if (status == READ_ENTIRE_FILE_NOT_FOUND) {
-                LOG(LOG_ERROR, "Could not find font %S\n", *file);
-            } else if (status == READ_ENTIRE_FILE_READ_ERROR) {
-                LOG(LOG_ERROR, "Could not read font %S\n", *file);
-            }
-
+        PlatformMappedFile ttf = platform_map_file(t_format("%S/%S", font_dir, *file));
+        if (ttf.content.size == 0) {
+            LOG(LOG_ERROR, "Could not open font %S\n", *file);
             continue;
         }
 
-        stbtt_InitFont(&stb, ttf.data, stbtt_GetFontOffsetForIndex(ttf.data, 0));
-        r32 scale = stbtt_ScaleForPixelHeight(&stb, font_height);
+        // NOTE: Only the table directory and the head table are touched here, the rest of the
+        //       file is paged in when the style is used.
+        u8 *head = find_font_table(ttf.content, "head");
+        if (head == 0 || head + 54 > ttf.content.data + ttf.content.size) {
+            LOG(LOG_ERROR, "Font %S has no head table\n", *file);
+            platform_unmap_file(&ttf);
+            continue;
+        }
 
-        u16 const bold   = 0x01;
-        u16 const italic = 0x02;
-        u16 const bold_italic = bold | italic;
-        u16 mac_style = *(u16*)(ttf.data + stb.head + 45);
+        u8 const bold   = 0x01;
+        u8 const italic = 0x02;
+        u8 const bold_italic = bold | italic;
+        u8 mac_style = head[45]; // Low byte of the big endian macStyle field.
 
         u32 kind = CONSOLE_FONT_REGULAR;
         if ((mac_style & bold_italic) == bold_italic) {
@@ -258,43 +510,397 @@ void init(ConsoleFont *font, r32 font_height, String font_dir, String font_famil
             kind = CONSOLE_FONT_ITALIC;
         }
 
-        int unscaled_ascent, unscaled_descent, unscaled_line_gap;
-        stbtt_GetFontVMetrics(&stb, &unscaled_ascent, &unscaled_descent, &unscaled_line_gap);
-
-        r32 ascent  = unscaled_ascent * scale;
-        r32 descent = unscaled_descent * scale;
+        if (font->font_data[kind].file.content.size) platform_unmap_file(&font->font_data[kind].file);
+        font->font_data[kind].file = ttf;
 
-        int unscaled_advance_width, unscaled_lsb;
-        stbtt_GetCodepointHMetrics(&stb, ' ', &unscaled_advance_width, &unscaled_lsb);
+        // NOTE: Instead of hashing whole files the checksum and modification date from the head
+        //       table are used. The font tools update both whenever a font changes.
+        font->cache_key = hash_bytes(font->cache_key, &kind, sizeof(kind));
+        font->cache_key = hash_bytes(font->cache_key, &ttf.content.size, sizeof(ttf.content.size));
+        font->cache_key = hash_bytes(font->cache_key, head + 8, 4);
+        font->cache_key = hash_bytes(font->cache_key, head + 28, 8);
+    }
 
-        s32 width  = (s32)ceil(unscaled_advance_width * scale);
-        s32 height = (s32)ceil(ascent - descent);
+    // TODO: Check which of the other styles are missing, they are drawn with the regular one for now.
+    if (font->font_data[CONSOLE_FONT_REGULAR].file.content.size == 0) {
+        LOG(LOG_ERROR, "Could not find the regular style of font %S\n", font_family);
+        return;
+    }
 
-        if (font->glyph_width  < width)  font->glyph_width  = width;
-        if (font->glyph_height < height) font->glyph_height = height;
+    // NOTE: The cell size only comes from the regular style, so the others don't have to be parsed.
+    //       Glyphs that are bigger are cut off at the cell border.
+    STBFont *regular = font_style(font, CONSOLE_FONT_REGULAR);
 
-        STBFont data = {};
-        data.data    = ttf;
-        data.info    = stb;
-        data.scale   = scale;
-        data.ascent  = ascent;
-        data.descent = descent;
+    int unscaled_advance_width, unscaled_lsb;
+    stbtt_GetCodepointHMetrics(&regular->info, ' ', &unscaled_advance_width, &unscaled_lsb);
 
-        font->font_data[kind] = data;
-    }
+    font->glyph_width  = (s32)ceil(unscaled_advance_width * regular->scale);
+    font->glyph_height = (s32)ceil(regular->ascent - regular->descent);
 
-    // TODO: Check if all or at least the regular font are loaded.
+    font->cache_key = hash_bytes(font->cache_key, &font_height, sizeof(font_height));
 
     init(&font->glyph_table, 1024);
     font->atlas = allocate_string(FONT_ATLAS_DIMENSION * FONT_ATLAS_DIMENSION);
 
     font->glyphs_per_line = (s32)(FONT_ATLAS_DIMENSION / font->glyph_width);
-    font->max_glyphs      = font->glyphs_per_line * (s32)(FONT_ATLAS_DIMENSION / font->glyph_height);
+    font->shelf_count     = (s32)(FONT_ATLAS_DIMENSION / font->glyph_height);
+    font->max_glyphs      = font->glyphs_per_line * font->shelf_count;
 
-    // TODO: proper loading of needed characters
-    for (s32 i = 20; i < 128; i += 1) {
-        font_add_glyph(font, CONSOLE_FONT_REGULAR, i);
-    }
+    font->slots = allocate_array<ConsoleGlyphSlot>(font->max_glyphs, font->allocator);
+    for (s32 i = 0; i < ConsoleMaxGlyphWidth; i += 1) font->shelves[i].shelf = -1;
+
+    // NOTE: The first shelf starts with the blank slot.
+    font->shelves[0].shelf = 0;
+    font->shelves[0].fill  = 1;
+    font->shelves_used     = 1;
+    font->slots[0].width   = 1;
+    font->blank_glyph.offset_in_atlas = slot_offset(font, 0);
+    font->blank_glyph.width = 1;
+
+    // NOTE: Starts at 1, a slot with last_used_frame 0 was never touched.
+    font->frame = 1;
+
+    // NOTE: Shown for the escape character.
     font_add_glyph(font, CONSOLE_FONT_REGULAR, 0x5E, 0x1B);
 }
 
+
+// NOTE: The timeout only guards against a missed signal, queue_glyph wakes the worker up.
+s32 const GlyphWorkerWaitTimeout = 100;
+
+INTERNAL s32 glyph_worker_thread(void *data) {
+    GlyphWorker *worker = (GlyphWorker*)data;
+    ConsoleFont *font = worker->font;
+
+    s64 tile_size = ConsoleMaxGlyphWidth * font->glyph_width * font->glyph_height;
+
+    for (;;) {
+        s64 finished  = worker->finished;
+        s64 submitted = atomic_load_acquire(&worker->submitted);
+
+        if (finished == submitted) {
+            if (atomic_load_acquire(&font->stop_workers)) break;
+
+            platform_wait_event(&worker->work_available, GlyphWorkerWaitTimeout);
+            continue;
+        }
+
+        s64 index = finished & (GlyphWorkerCapacity - 1);
+        GlyphJob *job = &worker->jobs[index];
+        u8 *tile = worker->tiles + index * tile_size;
+
+        s32 stride = job->width * font->glyph_width;
+        zero_memory(tile, stride * font->glyph_height);
+        rasterize_glyph(font, job->stb, job->glyph, job->width, tile, stride);
+
+        atomic_store_release(&worker->finished, finished + 1);
+
+        // NOTE: One wake up per batch is enough, the main thread applies everything that is done.
+        if (finished + 1 == atomic_load_acquire(&worker->submitted)) platform_wake_main_thread();
+    }
+
+    return 0;
+}
+
+void start_glyph_workers(ConsoleFont *font, s32 count) {
+    assert(font->workers.size == 0);
+
+    font->workers = allocate_array<GlyphWorker>(count, font->allocator);
+    font->stop_workers = false;
+
+    s64 tile_size = ConsoleMaxGlyphWidth * font->glyph_width * font->glyph_height;
+
+    FOR (font->workers, worker) {
+        worker->font  = font;
+        worker->tiles = ALLOC(font->allocator, u8, GlyphWorkerCapacity * tile_size);
+        worker->work_available = platform_create_event();
+    }
+
+    s32 started = 0;
+    FOR (font->workers, worker) {
+        worker->thread = platform_create_thread(glyph_worker_thread, worker);
+        if (worker->thread == 0) break;
+
+        started += 1;
+    }
+
+    if (started < count) {
+        LOG(LOG_ERROR, "Could not start the glyph workers, rasterizing on the main thread.\n");
+        stop_glyph_workers(font);
+    }
+}
+
+void stop_glyph_workers(ConsoleFont *font) {
+    atomic_store_release(&font->stop_workers, true);
+
+    s64 tile_size = ConsoleMaxGlyphWidth * font->glyph_width * font->glyph_height;
+
+    FOR (font->workers, worker) {
+        if (worker->thread) {
+            platform_signal_event(&worker->work_available);
+            platform_join_thread(worker->thread);
+            platform_destroy_thread(worker->thread);
+        }
+
+    }
+
+    apply_rasterized_glyphs(font);
+
+    FOR (font->workers, worker) {
+        platform_destroy_event(&worker->work_available);
+        DEALLOC(font->allocator, worker->tiles, GlyphWorkerCapacity * tile_size);
+    }
+
+    destroy_array(&font->workers, font->allocator);
+    font->workers = {};
+}
+
+void apply_rasterized_glyphs(ConsoleFont *font) {
+    s64 tile_size = ConsoleMaxGlyphWidth * font->glyph_width * font->glyph_height;
+
+    FOR (font->workers, worker) {
+        s64 finished = atomic_load_acquire(&worker->finished);
+
+        for (; worker->applied < finished; worker->applied += 1) {
+            s64 index = worker->applied & (GlyphWorkerCapacity - 1);
+            GlyphJob *job = &worker->jobs[index];
+
+            // NOTE: The slot could have been evicted and handed out again in the meantime.
+            if (font->slots[job->slot].key != job->key) continue;
+
+            V2i offset = slot_offset(font, job->slot);
+            u8 *tile = worker->tiles + index * tile_size;
+            s32 stride = job->width * font->glyph_width;
+            for (s32 y = 0; y < font->glyph_height; y += 1) {
+                copy_memory(&font->atlas[(offset.y + y) * FONT_ATLAS_DIMENSION + offset.x], tile + y * stride, stride);
+            }
+            mark_atlas_dirty(font, {offset.x, offset.y, stride, font->glyph_height});
+        }
+    }
+}
+
+u32 const GlyphCacheMagic   = 0x43475454; // "TTGC"
+u32 const GlyphCacheVersion = 2;
+
+// The header is followed by the glyphs, each one a u32 key, a u32 width in cells and a tile of
+// width * glyph_width by glyph_height pixels.
+struct GlyphCacheHeader {
+    u32 magic;
+    u32 version;
+    u64 key;
+    s32 glyph_width;
+    s32 glyph_height;
+};
+
+b32 load_glyph_cache(ConsoleFont *font, String cache_dir) {
+    font->cache_file = format("%S/glyphs_%U.cache", cache_dir, font->cache_key);
+    font->cache_entries = 0;
+
+    PlatformMappedFile file = platform_map_file(font->cache_file);
+    DEFER(platform_unmap_file(&file));
+
+    String content = file.content;
+    if (content.size < (s64)sizeof(GlyphCacheHeader)) return false;
+
+    GlyphCacheHeader header;
+    copy_memory(&header, content.data, sizeof(header));
+    if (header.magic != GlyphCacheMagic || header.version != GlyphCacheVersion || header.key != font->cache_key ||
+        header.glyph_width != font->glyph_width || header.glyph_height != font->glyph_height) {
+        LOG(LOG_ERROR, "Glyph cache %S does not match the fonts and is replaced.\n", font->cache_file);
+
+        return false;
+    }
+
+    s64 pos = sizeof(header);
+    while (pos + 2 * (s64)sizeof(u32) <= content.size) {
+        u32 key, width;
+        copy_memory(&key,   content.data + pos, sizeof(key));
+        copy_memory(&width, content.data + pos + sizeof(key), sizeof(width));
+        if (width == 0 || width > (u32)ConsoleMaxGlyphWidth) break;
+        // NOTE: The key indexes the direct glyph tables, so a garbled one counts as the broken tail as well.
+        if ((key >> 24) >= CONSOLE_FONT_KIND_COUNT || (key & 0xFFFFFF) > 0x10FFFF) break;
+
+        s32 stride = width * font->glyph_width;
+        u8 *tile = content.data + pos + sizeof(key) + sizeof(width);
+        pos += sizeof(key) + sizeof(width) + stride * font->glyph_height;
+        if (pos > content.size) break;
+
+        font->cache_entries += 1;
+
+        // NOTE: Later runs append glyphs again that were evicted before, so there can be doubles.
+        //       Loading never evicts, the file can hold more glyphs than the atlas.
+        if (glyph_loaded(font, key)) continue;
+
+        s32 slot = take_free_slot(font, width);
+        if (slot == 0) continue;
+        font->slots[slot].in_cache_file = true;
+
+        V2i offset = slot_offset(font, slot);
+        for (s32 y = 0; y < font->glyph_height; y += 1) {
+            copy_memory(&font->atlas[(offset.y + y) * FONT_ATLAS_DIMENSION + offset.x], tile + y * stride, stride);
+        }
+        mark_atlas_dirty(font, {offset.x, offset.y, stride, font->glyph_height});
+
+        register_glyph(font, key, slot);
+    }
+
+    // NOTE: An append that was cut short, by a crash or a full disk, leaves a broken tail.
+    //       Anything appended after it could never be read, so the file is rewritten on the next save.
+    if (pos != content.size) {
+        LOG(LOG_ERROR, "Glyph cache %S is damaged and is replaced.\n", font->cache_file);
+
+        font->cache_entries = 0;
+    }
+
+    return true;
+}
+
+INTERNAL void write_cache_entry(StringBuilder *builder, ConsoleFont *font, s32 slot) {
+    u32 width = font->slots[slot].width;
+    append_raw(builder, &font->slots[slot].key, sizeof(u32));
+    append_raw(builder, &width, sizeof(width));
+
+    V2i offset = slot_offset(font, slot);
+    for (s32 y = 0; y < font->glyph_height; y += 1) {
+        append_raw(builder, &font->atlas[(offset.y + y) * FONT_ATLAS_DIMENSION + offset.x], width * font->glyph_width);
+    }
+}
+
+INTERNAL b32 write_whole_file(String filename, u32 mode, String content) {
+    PlatformFile file = platform_create_file_handle(filename, mode);
+    if (!file.open) return false;
+    DEFER(platform_close_file_handle(&file));
+
+    return platform_write(&file, content.data, content.size) == content.size;
+}
+
+void save_glyph_cache(ConsoleFont *font) {
+    assert(font->workers.size == 0);
+    if (font->cache_file.size == 0) return;
+
+    s32 new_glyphs = 0;
+    for (s32 slot = 1; slot < font->max_glyphs; slot += 1) {
+        if (font->slots[slot].width && !font->slots[slot].in_cache_file) new_glyphs += 1;
+    }
+
+    // NOTE: Without a valid file, or when most of it are glyphs that no longer fit into the atlas,
+    //       it is written from scratch.
+    b32 rewrite = font->cache_entries == 0 || font->cache_entries + new_glyphs > 2 * (s64)font->max_glyphs;
+    if (!rewrite && new_glyphs == 0) return;
+
+    StringBuilder builder = {};
+    DEFER(destroy(&builder));
+
+    if (rewrite) {
+        GlyphCacheHeader header = {};
+        header.magic   = GlyphCacheMagic;
+        header.version = GlyphCacheVersion;
+        header.key     = font->cache_key;
+        header.glyph_width  = font->glyph_width;
+        header.glyph_height = font->glyph_height;
+        append_raw(&builder, &header, sizeof(header));
+    }
+
+    s64 written = 0;
+    for (s32 slot = 1; slot < font->max_glyphs; slot += 1) {
+        if (font->slots[slot].width == 0) continue;
+
+        if (rewrite || !font->slots[slot].in_cache_file) {
+            write_cache_entry(&builder, font, slot);
+            written += 1;
+        }
+    }
+
+    String content = to_allocated_string(&builder);
+    DEFER(destroy_string(&content));
+
+    if (rewrite) {
+        // NOTE: Other instances can have the file mapped right now and truncating it would pull the
+        //       pages out from under them. A complete new file replaces it instead.
+        String temp_file = t_format("%S.%u.tmp", font->cache_file, platform_process_id());
+        if (!write_whole_file(temp_file, PLATFORM_FILE_WRITE, content) || !platform_rename_file(temp_file, font->cache_file)) {
+            LOG(LOG_ERROR, "Could not replace the glyph cache %S.\n", font->cache_file);
+            platform_delete_file_or_directory(temp_file);
+
+            return;
+        }
+
+        font->cache_entries = written;
+    } else {
+        // NOTE: All entries go out in a single write, so instances appending at the same time
+        //       do not interleave their entries.
+        if (!write_whole_file(font->cache_file, PLATFORM_FILE_APPEND, content)) {
+            LOG(LOG_ERROR, "Could not append to the glyph cache %S.\n", font->cache_file);
+
+            return;
+        }
+
+        font->cache_entries += written;
+    }
+
+    for (s32 slot = 1; slot < font->max_glyphs; slot += 1) {
+        if (font->slots[slot].width) font->slots[slot].in_cache_file = true;
+    }
+}
+
+struct GlyphRange {
+    u32 first;
+    u32 last;
+};
+
+void prewarm_glyphs(ConsoleFont *font) {
+    if (!font->workers.size) return;
+
+    GlyphRange const ranges[] = {
+        {0x0020, 0x007E}, // ASCII
+        {0x00A0, 0x00FF}, // Latin-1
+        {0x2500, 0x259F}, // Box drawing and block elements
+        {0xE0A0, 0xE0D4}, // Powerline
+    };
+
+    for (s32 i = 0; i < (s32)(sizeof(ranges) / sizeof(ranges[0])); i += 1) {
+        for (u32 cp = ranges[i].first; cp <= ranges[i].last; cp += 1) {
+            if (glyph_loaded(font, console_glyph_key(CONSOLE_FONT_REGULAR, cp))) continue;
+
+            // NOTE: Prewarming never evicts anything and stops when the queues are full,
+            //       the rest is loaded on first use.
+            if (!find_free_worker(font)) return;
+
+            add_glyph(font, CONSOLE_FONT_REGULAR, cp, 0, true);
+        }
+    }
+}
+
+ConsoleAtlasOccupancy font_atlas_occupancy(ConsoleFont *font) {
+    ConsoleAtlasOccupancy result = {};
+    result.cells_total   = font->max_glyphs - 1;
+    result.shelves_used  = font->shelves_used;
+    result.shelves_total = font->shelf_count;
+
+    for (s32 slot = 1; slot < font->max_glyphs; slot += 1) {
+        s32 width = font->slots[slot].width;
+        if (width == 0) continue;
+
+        result.glyphs += 1;
+        if (width > 1) result.wide_glyphs += 1;
+        result.cells_used += width;
+
+        u32 key  = font->slots[slot].key;
+        u32 kind = key >> 24;
+        u32 cp   = key & 0xFFFFFF;
+        if (cp == 0x1B) cp = 0x5E; // NOTE: See the mapping in init.
+
+        STBFont *stb = font_style(font, kind);
+        s32 glyph = stbtt_FindGlyphIndex(&stb->info, cp);
+
+        int x0, x1, y0, y1;
+        stbtt_GetGlyphBitmapBox(&stb->info, glyph, stb->scale, stb->scale, &x0, &y0, &x1, &y1);
+        result.ink_pixels += (s64)(x1 - x0) * (y1 - y0);
+
+        s32 right = glyph_right_edge(stb, glyph);
+        if (right > font->glyph_width)         result.wider_than_cell += 1;
+        if (right > width * font->glyph_width) result.cut_off += 1;
+    }
+
+    return result;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "definitions.h"
+#include "platform.h"
 #include "stb_truetype.h"
 
 #include "hash_table.h"
@@ -20,35 +21,32 @@ struct GlyphInfo {
 
     r32 x0, y0, x1, y1;
     r32 u0, v0, u1, v1;
+
+    // The atlas cell and which glyph it held, the console font can evict it.
+    s32 slot;
+    u32 key;
 };
 
 // TODO: use the maximum texture size of the GPU
 #define FONT_ATLAS_DIMENSION 2048
 r32 const FONT_ATLAS_RATIO = 1.0f / FONT_ATLAS_DIMENSION;
+// Proportional text for the UI. It has no atlas of its own, the glyphs are the cells of the regular
+// style of a console font, so both share one texture and a glyph is only rasterized once.
 struct Font {
-    String data;
-    stbtt_fontinfo stb_info;
+    struct ConsoleFont *atlas_font;
 
-    r32 scale;
     r32 ascent;
     r32 line_advance;
 
     r32 tile_width;
     r32 tile_height;
 
-    s32 glyphs_per_line;
-    s32 tile_max;
-    s32 tile_count;
-
-    b32 is_dirty;
-
-    String atlas;
     HashTable<u32, GlyphInfo, u32, glyph_hash> glyph_table;
 };
 
 
 GlyphInfo *get_glyph(Font *font, u32 cp);
-void init(Font *font, r32 height, String font_data);
+void init(Font *font, struct ConsoleFont *atlas_font);
 void destroy(Font *font);
 
 r32 text_width(Font *font, String text);
@@ -67,8 +65,10 @@ enum ConsoleFontKind {
     CONSOLE_FONT_KIND_COUNT,
 };
 
+// The file is mapped in init, but only parsed when the first glyph of the style is needed.
 struct STBFont {
-    String data;
+    PlatformMappedFile file;
+    b32 loaded;
     stbtt_fontinfo info;
 
     r32 scale;
@@ -78,14 +78,96 @@ struct STBFont {
 };
 
 struct ConsoleGlyphInfo {
-    V2i offset_in_atlas[CONSOLE_FONT_KIND_COUNT];
-    b32 loaded[CONSOLE_FONT_KIND_COUNT];
+    V2i offset_in_atlas;
+    s32 slot;
+    s32 width; // In cells.
+};
+
+// The glyph table is keyed on both, the code point only needs 21 bits.
+inline u32 console_glyph_key(u32 kind, u32 cp) {
+    return (kind << 24) | cp;
+}
+
+// Code points below this are looked up directly in ConsoleFont.direct_glyphs, the hash table only
+// holds the rest.
+u32 const ConsoleDirectGlyphCount = 256;
+
+// Glyphs that stick out of their cell by more than a bit get two cells, like wide CJK characters or
+// Nerd Font icons. They are drawn over the next cell. Anything wider is cut off.
+s32 const ConsoleMaxGlyphWidth = 2;
+
+// The atlas is packed in shelves, rows that are one cell high. A shelf only holds glyphs of one width,
+// so slots of the same width can replace each other and no space is lost between them.
+// A slot is named after its first cell, the other cells of a wide glyph are not used on their own.
+struct ConsoleGlyphSlot {
+    u32 key;
+
+    s32 newer;
+    s32 older;
+    u8 width; // In cells, 0 if the slot is not handed out.
+    b8 in_cache_file;
+
+    u64 last_used_frame;
+};
+
+// The slots of one width form a list from the most to the least recently used glyph, the last one
+// is evicted when there is no room left for a glyph of that width.
+struct ConsoleGlyphShelves {
+    s32 shelf; // The one that is filled right now, -1 if there is none.
+    s32 fill;  // Cells of it in use.
+
+    s32 glyphs;
+    s32 most_recent;
+    s32 least_recent;
+};
+
+struct ConsoleAtlasOccupancy {
+    s32 glyphs;
+    s32 wide_glyphs;
+
+    s32 cells_used; // Wide glyphs count all of their cells.
+    s32 cells_total;
+    s32 shelves_used;
+    s32 shelves_total;
+
+    // Area of the tight bounding boxes, what a packer without cells could get away with.
+    s64 ink_pixels;
+    s32 wider_than_cell;
+    s32 cut_off; // Glyphs that are still too wide for their slot.
+};
+
+// A glyph to rasterize on a worker thread, into the staging tile with the same index as the job.
+struct GlyphJob {
+    u32 key;
+    s32 slot;
+    s32 width;
+    struct STBFont *stb;
+    s32 glyph; // Index in the font, not the code point.
+};
+
+s64 const GlyphWorkerCapacity = 256; // NOTE: Needs to be a power of two.
+
+// Single producer/single consumer, like the pipe reader. The main thread queues jobs and applies
+// the results, the worker only moves finished forward.
+struct GlyphWorker {
+    struct ConsoleFont *font;
+    PlatformThread *thread;
+
+    PlatformEvent work_available;
+
+    GlyphJob jobs[GlyphWorkerCapacity];
+    u8 *tiles; // GlyphWorkerCapacity tiles big enough for the widest glyph.
+
+    s64 volatile submitted;
+    s64 volatile finished;
+    s64 applied; // Only touched by the main thread.
 };
 
 struct ConsoleFont {
     Allocator allocator;
 
     STBFont font_data[CONSOLE_FONT_KIND_COUNT];
+    r32 font_height;
 
     s32 glyph_width;
     s32 glyph_height;
@@ -94,14 +176,90 @@ struct ConsoleFont {
 
     s32 glyphs_per_line;
     s32 max_glyphs;
-
-    V2i next_free_glyph;
+    s32 shelf_count;
 
     String atlas;
     HashTable<u32, ConsoleGlyphInfo, u32, glyph_hash> glyph_table;
+    ConsoleGlyphInfo direct_glyphs[CONSOLE_FONT_KIND_COUNT][ConsoleDirectGlyphCount]; // .slot is 0 if not loaded.
+
+    // NOTE: Slot 0 is never handed out, it stays empty and is used when nothing can be evicted.
+    Array<ConsoleGlyphSlot> slots;
+    ConsoleGlyphInfo blank_glyph;
+    ConsoleGlyphShelves shelves[ConsoleMaxGlyphWidth]; // Indexed by width - 1.
+    s32 shelves_used;
+
+    // Glyphs used during the current frame are pinned, evicting them would change what is on screen.
+    u64 frame;
+
+    s64 hits;
+    s64 misses;
+    s64 evictions;
+
+    // If there are workers new glyphs are rasterized in the background and stay empty until the
+    // result is applied. Without workers they are rasterized right away.
+    Array<GlyphWorker> workers;
+    s32 next_worker;
+    s32 volatile stop_workers;
+
+    // Glyphs from earlier runs, see load_glyph_cache.
+    u64 cache_key;     // Covers the font files, the size and which styles are loaded.
+    String cache_file; // Empty if no cache is used.
+    s64 cache_entries; // Glyphs in the file, including ones that were evicted since.
+
+    // Parts of the atlas that changed since the last upload. Glyphs next to each other on the
+    // same line of the atlas are merged into one region.
+    DArray<Rect2i> dirty_regions;
 };
 
 void init(ConsoleFont *font, r32 height, String font_dir, String font_family, Allocator alloc = default_allocator());
 
-ConsoleGlyphInfo *get_glyph(ConsoleFont *font, u32 kind, u32 cp);
+// Call after the dirty regions were uploaded.
+void clear_atlas_changes(ConsoleFont *font);
+
+// Unpins the glyphs of the last frame.
+void next_font_frame(ConsoleFont *font);
+
+// Glyphs rasterized by an earlier run with the same fonts and size are copied into the atlas.
+// Call right after init. Returns false if there was no usable cache file, it is created on save.
+b32 load_glyph_cache(ConsoleFont *font, String cache_dir);
+// Appends the glyphs that are not in the file yet. If it holds too many evicted glyphs it is
+// written again from scratch. The workers have to be stopped.
+void save_glyph_cache(ConsoleFont *font);
+
+void start_glyph_workers(ConsoleFont *font, s32 count);
+// Waits for the queued glyphs and applies them.
+void stop_glyph_workers(ConsoleFont *font);
+
+// Copies finished glyphs into the atlas and marks them dirty. Call once per main loop iteration,
+// the workers wake up the main thread when they finish something.
+void apply_rasterized_glyphs(ConsoleFont *font);
+
+// Queues common ranges like Latin-1, box drawing and Powerline symbols on the workers.
+// Does nothing without workers, they would all be rasterized on the spot.
+void prewarm_glyphs(ConsoleFont *font);
+
+// Walks over every glyph in the atlas, meant for statistics.
+ConsoleAtlasOccupancy font_atlas_occupancy(ConsoleFont *font);
+
+ConsoleGlyphInfo *font_add_glyph(ConsoleFont *font, u32 kind, u32 cp, u32 mapping = 0);
+void touch_glyph_slot(ConsoleFont *font, s32 slot);
+
+// Never returns 0. If every slot is pinned the glyph is drawn blank.
+// NOTE: Other glyphs can be evicted by this call, so only use offsets handed out during the current
+//       frame, or check the evictions counter to see if older ones are still valid.
+inline ConsoleGlyphInfo *get_glyph(ConsoleFont *font, u32 kind, u32 cp) {
+    ConsoleGlyphInfo *info;
+    if (cp < ConsoleDirectGlyphCount) {
+        info = &font->direct_glyphs[kind][cp];
+        if (info->slot == 0) return font_add_glyph(font, kind, cp);
+    } else {
+        info = find(&font->glyph_table, console_glyph_key(kind, cp));
+        if (!info) return font_add_glyph(font, kind, cp);
+    }
+
+    font->hits += 1;
+    touch_glyph_slot(font, info->slot);
+
+    return info;
+}
 
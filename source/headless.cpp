@@ -0,0 +1,565 @@
+#include "console.h"
+#include "benchmark.h"
+#include "platform.h"
+#include "io.h"
+#include "string2.h"
+#include "memory.h"
+#include "utf.h"
+
+
+// Runs the terminal core without a window so parse and grid throughput can be measured
+// and regression tested on machines without a display.
+//
+//     thermal_headless [options] <file>
+//     thermal_headless [options] --exec <command>
+//     thermal_headless [options] --bench
+//     thermal_headless [options] --bench-glyphs
+//     thermal_headless --check
+//
+//     --size <columns>x<rows>  Grid size, 80x24 by default.
+//     --chunk <bytes>          Size of a single append when feeding a file, 64KB by default
+//                              which is what the pipe reader hands out.
+//     --repeat <count>         Feed the file this many times.
+//     --dump grid|hash|none    What to print after the timings, hash by default.
+//     --scrollback <limit>     Like "10000lines" or "64mb", see parse_scrollback_config.
+//
+//     --bench                  Run the generated workloads from benchmark.cpp instead.
+//     --bench-size <bytes>     Bytes generated per workload, 8MB by default.
+//     --runs <count>           Runs per workload, the fastest counts. 3 by default.
+//     --baseline <file>|none   Compare against a saved baseline and fail on regressions.
+//                              data/benchmark_baseline.txt by default, it only applies to the
+//                              default sizes and gets skipped for others.
+//     --save-baseline <file>   Write the results as the new baseline.
+//     --threshold <percent>    Allowed regression against the baseline, 10 by default.
+//
+//     --bench-glyphs           Measure the glyph lookup per cell instead, see run_glyph_benchmark.
+//     --font-dir <dir>         Where the console font is loaded from, data/fonts by default.
+//
+//     --check                  Run the self checks below and fail if one of them does.
+
+enum HeadlessDump {
+    HEADLESS_DUMP_NONE,
+    HEADLESS_DUMP_GRID,
+    HEADLESS_DUMP_HASH,
+};
+
+struct HeadlessOptions {
+    String file;
+    String command;
+
+    V2i size;
+    s64 chunk;
+    s64 repeat;
+
+    HeadlessDump dump;
+    ScrollbackConfig scrollback;
+    b32 has_scrollback;
+
+    b32 bench;
+    b32 bench_glyphs;
+    b32 check;
+    BenchmarkOptions bench_options;
+};
+
+struct HeadlessStats {
+    s64 bytes;
+    s64 appends;
+
+    r64 append_time;
+    r64 total_time;
+};
+
+
+INTERNAL b32 parse_options(Array<String> args, HeadlessOptions *options) {
+    options->size   = {80, 24};
+    options->chunk  = KILOBYTES(64);
+    options->repeat = 1;
+    options->dump   = HEADLESS_DUMP_HASH;
+
+    options->bench_options.input_size = MEGABYTES(8);
+    options->bench_options.runs       = 3;
+    options->bench_options.threshold  = 10;
+    options->bench_options.font_dir   = "data/fonts";
+    options->bench_options.baseline   = "data/benchmark_baseline.txt";
+
+    for (s64 i = 1; i < args.size; i += 1) {
+        String arg = args[i];
+        b32 has_value = i + 1 < args.size;
+
+        if (arg == "--exec" && has_value) {
+            i += 1;
+            options->command = args[i];
+        } else if (arg == "--size" && has_value) {
+            i += 1;
+            SplitResult split = split_at(args[i], 'x');
+
+            s64 columns, rows;
+            if (!parse_s64(split.first, &columns) || !parse_s64(split.second, &rows) || columns < 1 || rows < 1) {
+                print("Invalid size %S, expected <columns>x<rows>.\n", args[i]);
+                return false;
+            }
+            options->size = {(s32)columns, (s32)rows};
+        } else if (arg == "--chunk" && has_value) {
+            i += 1;
+            if (!parse_s64(args[i], &options->chunk) || options->chunk < 1) {
+                print("Invalid chunk size %S.\n", args[i]);
+                return false;
+            }
+        } else if (arg == "--repeat" && has_value) {
+            i += 1;
+            if (!parse_s64(args[i], &options->repeat) || options->repeat < 1) {
+                print("Invalid repeat count %S.\n", args[i]);
+                return false;
+            }
+        } else if (arg == "--dump" && has_value) {
+            i += 1;
+            if      (args[i] == "grid") options->dump = HEADLESS_DUMP_GRID;
+            else if (args[i] == "hash") options->dump = HEADLESS_DUMP_HASH;
+            else if (args[i] == "none") options->dump = HEADLESS_DUMP_NONE;
+            else {
+                print("Unknown dump mode %S.\n", args[i]);
+                return false;
+            }
+        } else if (arg == "--scrollback" && has_value) {
+            i += 1;
+            if (!parse_scrollback_config(args[i], &options->scrollback)) {
+                print("Invalid scrollback limit %S, expected <count>lines or <megabytes>mb.\n", args[i]);
+                return false;
+            }
+            options->has_scrollback = true;
+        } else if (arg == "--bench") {
+            options->bench = true;
+        } else if (arg == "--bench-glyphs") {
+            options->bench_glyphs = true;
+        } else if (arg == "--check") {
+            options->check = true;
+        } else if (arg == "--font-dir" && has_value) {
+            i += 1;
+            options->bench_options.font_dir = args[i];
+        } else if (arg == "--bench-size" && has_value) {
+            i += 1;
+            if (!parse_s64(args[i], &options->bench_options.input_size) || options->bench_options.input_size < 1) {
+                print("Invalid benchmark size %S.\n", args[i]);
+                return false;
+            }
+        } else if (arg == "--runs" && has_value) {
+            i += 1;
+            s64 runs;
+            if (!parse_s64(args[i], &runs) || runs < 1) {
+                print("Invalid run count %S.\n", args[i]);
+                return false;
+            }
+            options->bench_options.runs = (s32)runs;
+        } else if (arg == "--baseline" && has_value) {
+            i += 1;
+            if (args[i] == "none") options->bench_options.baseline = {};
+            else                   options->bench_options.baseline = args[i];
+        } else if (arg == "--save-baseline" && has_value) {
+            i += 1;
+            options->bench_options.save_baseline = args[i];
+        } else if (arg == "--threshold" && has_value) {
+            i += 1;
+            s64 threshold;
+            if (!parse_s64(args[i], &threshold) || threshold < 0) {
+                print("Invalid threshold %S.\n", args[i]);
+                return false;
+            }
+            options->bench_options.threshold = (s32)threshold;
+        } else if (!starts_with(arg, "--") && options->file.size == 0) {
+            options->file = arg;
+        } else {
+            print("Unknown option %S.\n", arg);
+            return false;
+        }
+    }
+
+    options->bench_options.size  = options->size;
+    options->bench_options.chunk = options->chunk;
+
+    if (options->bench || options->bench_glyphs || options->check) return true;
+
+    if ((options->file.size == 0) == (options->command.size == 0)) {
+        print("Usage: thermal_headless [--size <columns>x<rows>] [--chunk <bytes>] [--repeat <count>] [--dump grid|hash|none] [--scrollback <limit>] <file> | --exec <command>\n");
+        print("       thermal_headless [--size <columns>x<rows>] [--chunk <bytes>] --bench [--bench-size <bytes>] [--runs <count>] [--baseline <file>|none] [--save-baseline <file>] [--threshold <percent>]\n");
+        print("       thermal_headless [--size <columns>x<rows>] --bench-glyphs [--runs <count>] [--font-dir <dir>]\n");
+        print("       thermal_headless --check\n");
+        return false;
+    }
+
+    return true;
+}
+
+// NOTE: Every append stands for the output the window processes in one frame, so the display
+//       is updated after each one as well.
+INTERNAL void timed_append(ConsoleBuffer *buffer, HeadlessStats *stats, String str) {
+    r64 start = platform_get_time();
+    append(buffer, str);
+    update_display_buffer(buffer);
+    stats->append_time += platform_get_time() - start;
+
+    stats->bytes   += str.size;
+    stats->appends += 1;
+}
+
+INTERNAL void feed_file(ConsoleBuffer *buffer, HeadlessStats *stats, String content, HeadlessOptions *options) {
+    for (s64 pass = 0; pass < options->repeat; pass += 1) {
+        String rest = content;
+
+        while (rest.size) {
+            s64 size = rest.size;
+            if (size > options->chunk) size = options->chunk;
+
+            timed_append(buffer, stats, {rest.data, size});
+            rest = shrink_front(rest, size);
+        }
+    }
+}
+
+// Same path the window takes: a reader thread fills the ring and the output is appended
+// as it becomes available.
+INTERNAL b32 feed_child(ConsoleBuffer *buffer, HeadlessStats *stats, String command) {
+    PlatformExecutionContext pec = platform_execute(command, screen_size(buffer));
+    if (!pec.started_successfully) return false;
+
+    if (!start_pipe_reader(&buffer->reader, pec)) return false;
+
+    while (!pipe_reader_done(&buffer->reader)) {
+        String output = pipe_reader_peek(&buffer->reader);
+        if (output.size == 0) {
+            if (!pipe_reader_pending(&buffer->reader)) platform_wait_for_events(-1);
+            continue;
+        }
+
+        timed_append(buffer, stats, output);
+        pipe_reader_consume(&buffer->reader, output.size);
+    }
+    stop_pipe_reader(&buffer->reader);
+
+    return true;
+}
+
+// The hash only covers what is visible, with styles resolved to their colors, so it stays
+// comparable when the storage layout changes.
+INTERNAL u64 grid_hash(ConsoleBuffer *buffer, s32 rows) {
+    u64 hash = 14695981039346656037ull;
+
+    for (s64 i = 0; i < (s64)buffer->tile_count.x * rows; i += 1) {
+        ConsoleTile *tile = &buffer->display_buffer[i];
+        ConsoleStyle *style = get_style(buffer, tile->style);
+
+        u32 values[] = {tile->cp, style->fg, style->bg, style->font_kind};
+        for (s32 v = 0; v < (s32)ARRAY_SIZE(values); v += 1) {
+            hash = (hash ^ values[v]) * 1099511628211ull;
+        }
+    }
+
+    return hash;
+}
+
+INTERNAL void dump_grid(ConsoleBuffer *buffer, s32 rows) {
+    s32 columns = buffer->tile_count.x;
+
+    String row = allocate_string(columns * 4);
+    DEFER(destroy_string(&row));
+
+    for (s32 y = 0; y < rows; y += 1) {
+        ConsoleTile *tiles = &buffer->display_buffer[y * columns];
+
+        s32 used = columns;
+        while (used && (tiles[used - 1].cp == 0 || tiles[used - 1].cp == ' ')) used -= 1;
+
+        s64 size = 0;
+        for (s32 x = 0; x < used; x += 1) {
+            u32 cp = tiles[x].cp;
+            if (cp == ConsoleWideSpacer) continue;
+            if (cp == 0) cp = ' ';
+
+            UTF8CharResult c = to_utf8(cp);
+            copy_memory(row.data + size, c.byte, c.length);
+            size += c.length;
+        }
+
+        print("%S\n", String(row.data, size));
+    }
+}
+
+// Every cell gets its own 24 bit color, so more styles are referenced at once than the
+// table collects at. The last cell still has to show the color it was written with.
+INTERNAL b32 check_style_overflow(ConsoleBuffer *buffer) {
+    u32 count = ConsoleStyleCollectCount + 1024;
+
+    StringBuilder builder = {};
+    DEFER(destroy(&builder));
+    for (u32 i = 1; i <= count; i += 1) {
+        format(&builder, "\x1b[38;2;%u;%u;%um\x1b[48;2;%u;%u;%umX", (i >> 16) & 255, (i >> 8) & 255, i & 255, i & 255, (i >> 8) & 255, (i >> 16) & 255);
+    }
+    String output = to_allocated_string(&builder);
+    DEFER(destroy_string(&output));
+
+    append(buffer, output);
+    update_display_buffer(buffer);
+
+    V2i cursor = local_cursor_pos(buffer);
+    ConsoleTile *tile = &buffer->display_buffer[cursor.y * buffer->tile_count.x + cursor.x - 1];
+    ConsoleStyle *style = get_style(buffer, tile->style);
+
+    u32 fg = PACK_RGB((count >> 16) & 255, (count >> 8) & 255, count & 255);
+    u32 bg = PACK_RGB(count & 255, (count >> 8) & 255, (count >> 16) & 255);
+    if (tile->cp != 'X' || style->fg != fg || style->bg != bg) {
+        print("style_overflow: last cell has fg %u and bg %u, expected %u and %u.\n", style->fg, style->bg, fg, bg);
+        return false;
+    }
+
+    return true;
+}
+
+// The cursor row is pushed into the scrollback up to the cursor on a resize. Text that was
+// cleared from it before must not come back.
+INTERNAL b32 check_resize_after_clear(ConsoleBuffer *buffer) {
+    append(buffer, "this text was cleared\x1b[2J\x1b[1;12H");
+
+    buffer->tile_count = {60, 25};
+    reflow_lines(buffer);
+    update_display_buffer(buffer);
+
+    for (s32 x = 0; x < buffer->tile_count.x; x += 1) {
+        u32 cp = buffer->display_buffer[x].cp;
+        if (cp != 0 && cp != ' ') {
+            print("resize_after_clear: cleared text came back in column %d.\n", x);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Wide characters take two columns, and one that does not fit into the last column goes to the next row.
+INTERNAL b32 check_wide_characters(ConsoleBuffer *buffer) {
+    append(buffer, "\xE4\xBD\xA0\xE5\xA5\xBD" "ab");
+    if (local_cursor_pos(buffer).x != 6) {
+        print("wide_characters: cursor is in column %d after two wide characters, expected 6.\n", local_cursor_pos(buffer).x);
+        return false;
+    }
+
+    append(buffer, "cde\xE4\xBD\xA0");
+    update_display_buffer(buffer);
+
+    ConsoleTile *first  = &buffer->display_buffer[0];
+    ConsoleTile *second = &buffer->display_buffer[buffer->tile_count.x];
+    if (first[1].cp != ConsoleWideSpacer || first[9].cp != 0 || second[0].cp != 0x4F60 || second[1].cp != ConsoleWideSpacer) {
+        print("wide_characters: wide character was split over two rows.\n");
+        return false;
+    }
+
+    return true;
+}
+
+// Sub parameters separated by ':' are not supported. The sequence has to be dropped instead of
+// its parts being read as separate arguments, the empty color space in "38:2::255:0:0" would
+// otherwise end up as a reset.
+INTERNAL b32 check_colon_sub_parameters(ConsoleBuffer *buffer) {
+    append(buffer, "\x1b[32mA\x1b[38:2::255:0:0mB\x1b[31mC");
+    update_display_buffer(buffer);
+
+    ConsoleTile *tiles = &buffer->display_buffer[0];
+    u32 green = get_style(buffer, tiles[0].style)->fg;
+    if (tiles[1].cp != 'B' || get_style(buffer, tiles[1].style)->fg != green) {
+        print("colon_sub_parameters: the sequence with sub parameters changed the color.\n");
+        return false;
+    }
+    if (tiles[2].cp != 'C' || get_style(buffer, tiles[2].style)->fg == green) {
+        print("colon_sub_parameters: the sequence after it was not applied.\n");
+        return false;
+    }
+
+    return true;
+}
+
+// Lowering the byte limit shrinks a full ring right away. The newest lines have to survive it.
+INTERNAL b32 check_scrollback_limit(ConsoleBuffer *buffer) {
+    StringBuilder builder = {};
+    DEFER(destroy(&builder));
+    for (s32 i = 0; i < 100000; i += 1) {
+        format(&builder, "line %d of the scrollback\n", i);
+    }
+    String output = to_allocated_string(&builder);
+    DEFER(destroy_string(&output));
+
+    append(buffer, output);
+
+    ScrollbackConfig config;
+    if (!parse_scrollback_config("1 mb", &config)) {
+        print("scrollback_limit: \"1 mb\" was not accepted.\n");
+        return false;
+    }
+    set_scrollback(buffer, config);
+
+    if (buffer->ring.alloc > MEGABYTES(1)) {
+        print("scrollback_limit: the ring still takes %d bytes.\n", buffer->ring.alloc);
+        return false;
+    }
+
+    // NOTE: The screen holds the last 23 lines and the empty cursor row, the line above them
+    //       is the newest one in the ring.
+    buffer->scroll_offset = 1;
+    update_display_buffer(buffer);
+
+    String expected = "line 99976 of the scrollback";
+    ConsoleTile *tiles = &buffer->display_buffer[0];
+    for (s64 x = 0; x < expected.size; x += 1) {
+        if (tiles[x].cp != expected[x]) {
+            print("scrollback_limit: the newest scrollback line was lost.\n");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Erasing with a background color set fills the erased cells with it, whole rows included.
+INTERNAL b32 check_background_erase(ConsoleBuffer *buffer) {
+    append(buffer, "abc\x1b[44m\x1b[1;2H\x1b[K\x1b[3;1H\x1b[J");
+    update_display_buffer(buffer);
+
+    ConsoleTile *tiles = buffer->display_buffer.memory;
+    s32 columns = buffer->tile_count.x;
+
+    u32 blue = get_style(buffer, buffer->current_style)->bg;
+    s32 const cells[] = {1, columns - 1, 2 * columns, 23 * columns + columns - 1};
+    for (s32 i = 0; i < (s32)ARRAY_SIZE(cells); i += 1) {
+        ConsoleTile *tile = &tiles[cells[i]];
+        if (tile->cp != 0 || get_style(buffer, tile->style)->bg != blue) {
+            print("background_erase: cell %d of the display was not erased with the background color.\n", cells[i]);
+            return false;
+        }
+    }
+    if (tiles[0].cp != 'a' || get_style(buffer, tiles[0].style)->bg == blue || get_style(buffer, tiles[columns].style)->bg == blue) {
+        print("background_erase: cells outside of the erased range changed.\n");
+        return false;
+    }
+
+    return true;
+}
+
+// Scrolled back to the very start, then the lines get longer and fewer. The view has to stay in the scrollback.
+INTERNAL b32 check_resize_scroll_offset(ConsoleBuffer *buffer) {
+    StringBuilder builder = {};
+    DEFER(destroy(&builder));
+    for (s32 i = 0; i < 200; i += 1) {
+        append(&builder, "the quick brown fox jumps over the lazy dog the quick brown fox jumps \n");
+    }
+    String output = to_allocated_string(&builder);
+    DEFER(destroy_string(&output));
+
+    append(buffer, output);
+    buffer->scroll_offset = (s32)scrollback_line_count(buffer);
+
+    buffer->tile_count = {200, 25};
+    reflow_lines(buffer);
+
+    if (buffer->scroll_offset > scrollback_line_count(buffer)) {
+        print("resize_scroll_offset: scrolled back %d lines with only %D in the scrollback.\n", buffer->scroll_offset, scrollback_line_count(buffer));
+        return false;
+    }
+
+    return true;
+}
+
+// Every check gets a fresh buffer of the given size.
+struct HeadlessCheck {
+    char const *name;
+    V2i size;
+    b32 (*func)(ConsoleBuffer *buffer);
+};
+
+INTERNAL HeadlessCheck Checks[] = {
+    {"style_overflow",       {80, 25}, check_style_overflow},
+    {"resize_after_clear",   {80, 25}, check_resize_after_clear},
+    {"wide_characters",      {10, 25}, check_wide_characters},
+    {"colon_sub_parameters", {80, 25}, check_colon_sub_parameters},
+    {"scrollback_limit",     {80, 25}, check_scrollback_limit},
+    {"background_erase",     {80, 25}, check_background_erase},
+    {"resize_scroll_offset", {40, 25}, check_resize_scroll_offset},
+};
+
+INTERNAL s32 run_checks() {
+    s32 failed = 0;
+    for (s32 i = 0; i < (s32)ARRAY_SIZE(Checks); i += 1) {
+        ConsoleBuffer buffer = {};
+        init(&buffer);
+        buffer.tile_count = Checks[i].size;
+
+        b32 passed = Checks[i].func(&buffer);
+        destroy(&buffer);
+
+        print("%s %s\n", passed ? "ok  " : "FAIL", Checks[i].name);
+
+        if (!passed) failed += 1;
+    }
+
+    return failed ? 1 : 0;
+}
+
+s32 application_main(Array<String> args) {
+    log_to_file(Console.out);
+
+    HeadlessOptions options = {};
+    if (!parse_options(args, &options)) return 1;
+
+    if (options.bench) return run_benchmarks(&options.bench_options);
+    if (options.bench_glyphs) return run_glyph_benchmark(&options.bench_options);
+    if (options.check) return run_checks();
+
+    String content = {};
+    if (options.file.size) {
+        u32 status = 0;
+        content = read_entire_file(options.file, &status);
+        if (status != READ_ENTIRE_FILE_OK) {
+            print("Could not read %S.\n", options.file);
+            return 1;
+        }
+    }
+    DEFER(destroy_string(&content));
+
+    ConsoleBuffer buffer = {};
+    init(&buffer);
+    DEFER(destroy(&buffer));
+
+    // NOTE: The last row of the display belongs to the prompt, see visible_lines.
+    buffer.tile_count = {options.size.x, options.size.y + 1};
+
+    if (options.has_scrollback) set_scrollback(&buffer, options.scrollback);
+
+    HeadlessStats stats = {};
+
+    r64 start = platform_get_time();
+    if (options.file.size) {
+        feed_file(&buffer, &stats, content, &options);
+    } else if (!feed_child(&buffer, &stats, options.command)) {
+        print("Could not run %S.\n", options.command);
+        return 1;
+    }
+    stats.total_time = platform_get_time() - start;
+
+    r64 reflow_start = platform_get_time();
+    reflow_lines(&buffer);
+    update_display_buffer(&buffer);
+    r64 reflow_time = platform_get_time() - reflow_start;
+
+    r64 megabytes = stats.bytes / (1024.0 * 1024.0);
+    r64 append_time = stats.append_time > 0 ? stats.append_time : 1.0e-9;
+
+    print("bytes:      %D in %D appends\n", stats.bytes, stats.appends);
+    print("append:     %f s, %f MB/s, %f ns/byte\n", append_time, megabytes / append_time, append_time * 1.0e9 / (stats.bytes ? stats.bytes : 1));
+    print("total:      %f s\n", stats.total_time);
+    print("reflow:     %f s for %D lines\n", reflow_time, line_count(&buffer));
+    print("scrollback: %D bytes, %D styles\n", scrollback_memory(&buffer), buffer.styles.styles.size - buffer.styles.free_slots.size);
+
+    if (options.dump == HEADLESS_DUMP_HASH) {
+        print("hash:       %U\n", grid_hash(&buffer, options.size.y));
+    } else if (options.dump == HEADLESS_DUMP_GRID) {
+        dump_grid(&buffer, options.size.y);
+    }
+
+    return 0;
+}
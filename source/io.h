@@ -3,6 +3,8 @@
 #include "definitions.h"
 #include "memory.h"
 
+#include <cstdarg>
+
 
 enum {
     LOG_NONE,
@@ -13,7 +15,7 @@ void log(s32 line, String file, u32 mode, char const *fmt, ...);
 void log_to_file(struct PlatformFile *file);
 void log_flush();
 
-#define LOG(mode, fmt, ...) log(__LINE__, __FILE__, (mode), (fmt), __VA_ARGS__);
+#define LOG(mode, fmt, ...) log(__LINE__, __FILE__, (mode), (fmt), ##__VA_ARGS__);
 
 s64 convert_string_to_s64(u8 *buffer, s32 buffer_size);
 
@@ -0,0 +1,124 @@
+#include "opengl.cpp"
+
+
+// NOTE: GL/glx.h pulls in GL/gl.h which collides with our function pointers, so the few
+// GLX declarations that are needed live here.
+typedef struct __GLXcontextRec *GLXContext;
+typedef struct __GLXFBConfigRec *GLXFBConfig;
+typedef XID GLXDrawable;
+
+extern "C" {
+GLXFBConfig *glXChooseFBConfig(Display *display, int screen, int const *attributes, int *count);
+XVisualInfo *glXGetVisualFromFBConfig(Display *display, GLXFBConfig config);
+Bool glXMakeCurrent(Display *display, GLXDrawable drawable, GLXContext context);
+void glXSwapBuffers(Display *display, GLXDrawable drawable);
+void glXDestroyContext(Display *display, GLXContext context);
+VoidFunc *glXGetProcAddressARB(u8 const *name);
+}
+
+#define GLX_DOUBLEBUFFER			5
+#define GLX_RED_SIZE				8
+#define GLX_GREEN_SIZE				9
+#define GLX_BLUE_SIZE				10
+#define GLX_ALPHA_SIZE				11
+#define GLX_DEPTH_SIZE				12
+#define GLX_DRAWABLE_TYPE			0x8010
+#define GLX_RENDER_TYPE				0x8011
+#define GLX_X_RENDERABLE			0x8012
+#define GLX_WINDOW_BIT				0x00000001
+#define GLX_RGBA_BIT				0x00000001
+
+#define GLX_CONTEXT_MAJOR_VERSION_ARB		0x2091
+#define GLX_CONTEXT_MINOR_VERSION_ARB		0x2092
+#define GLX_CONTEXT_FLAGS_ARB			0x2094
+#define GLX_CONTEXT_PROFILE_MASK_ARB		0x9126
+#define GLX_CONTEXT_CORE_PROFILE_BIT_ARB	0x00000001
+#define GLX_CONTEXT_DEBUG_BIT_ARB		0x0001
+
+typedef void (*GLDEBUGPROCARB)(GLenum, GLenum, GLuint, GLenum, GLsizei, char const*, void const*);
+#define GL_DEBUG_OUTPUT				0x92E0
+#define GL_DEBUG_OUTPUT_SYNCHRONOUS		0x8242
+#define GL_DONT_CARE				0x1100
+
+
+INTERNAL GLXContext OpenGLContext;
+
+
+INTERNAL VoidFunc *load_gl_function(char const *name) {
+    return glXGetProcAddressARB((u8 const*)name);
+}
+
+INTERNAL void debug_output(GLenum, GLenum, u32 id, GLenum, GLsizei, char const *msg, void const *)
+{
+    if (id == 131169 || id == 131185 || id == 131218 || id == 131204) return;
+
+    print("------------------------------\n");
+    print("Debug message (%u): %s\n", id, msg);
+}
+
+// The window visual has to match the framebuffer config, so this is done before the window is created.
+INTERNAL GLXFBConfig choose_gl_config(Display *display, s32 screen) {
+    int attributes[] = {
+        GLX_X_RENDERABLE,  True,
+        GLX_DRAWABLE_TYPE, GLX_WINDOW_BIT,
+        GLX_RENDER_TYPE,   GLX_RGBA_BIT,
+        GLX_DOUBLEBUFFER,  True,
+        GLX_RED_SIZE,   8,
+        GLX_GREEN_SIZE, 8,
+        GLX_BLUE_SIZE,  8,
+        GLX_ALPHA_SIZE, 8,
+        GLX_DEPTH_SIZE, 24,
+        None
+    };
+
+    int count = 0;
+    GLXFBConfig *configs = glXChooseFBConfig(display, screen, attributes, &count);
+    if (!configs || count == 0) show_message_box_and_crash("ERROR_GLX_CHOOSE_FB_CONFIG");
+
+    GLXFBConfig config = configs[0];
+    XFree(configs);
+
+    return config;
+}
+
+INTERNAL void setup_gl_context(Display *display, Window window, GLXFBConfig config) {
+    GLXContext (*glXCreateContextAttribsARB)(Display*, GLXFBConfig, GLXContext, Bool, int const*);
+    glXCreateContextAttribsARB = (decltype(glXCreateContextAttribsARB))load_gl_function("glXCreateContextAttribsARB");
+    if (glXCreateContextAttribsARB == 0) show_message_box_and_crash("ERROR_GLX_CREATE_CONTEXT_ATTRIBS_ARB_NOT_LOADED");
+
+    int create_args[] = {
+        GLX_CONTEXT_MAJOR_VERSION_ARB, 3,
+        GLX_CONTEXT_MINOR_VERSION_ARB, 3,
+        GLX_CONTEXT_PROFILE_MASK_ARB,  GLX_CONTEXT_CORE_PROFILE_BIT_ARB,
+#ifdef DEVELOPER
+        GLX_CONTEXT_FLAGS_ARB,         GLX_CONTEXT_DEBUG_BIT_ARB,
+#endif
+        None
+    };
+    OpenGLContext = glXCreateContextAttribsARB(display, config, 0, True, create_args);
+    if (!OpenGLContext) show_message_box_and_crash("ERROR_GLX_CREATE_CONTEXT_ATTRIBS_ARB");
+
+    glXMakeCurrent(display, window, OpenGLContext);
+
+#ifdef DEVELOPER
+    {
+        void (*glEnable)(GLenum);
+        void (*glDebugMessageCallbackARB)(GLDEBUGPROCARB, void const*);
+        void (*glDebugMessageControlARB)(GLenum, GLenum, GLenum, GLsizei, GLuint const*, GLboolean);
+
+        glEnable = (decltype(glEnable))load_gl_function("glEnable");
+        glDebugMessageCallbackARB = (decltype(glDebugMessageCallbackARB))load_gl_function("glDebugMessageCallbackARB");
+        glDebugMessageControlARB = (decltype(glDebugMessageControlARB))load_gl_function("glDebugMessageControlARB");
+
+        if (glEnable && glDebugMessageCallbackARB && glDebugMessageControlARB) {
+            glEnable(GL_DEBUG_OUTPUT);
+            glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+            glDebugMessageCallbackARB(debug_output, 0);
+            glDebugMessageControlARB(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, 0, GL_TRUE);
+        } else {
+            print("NOTE: Could not init OpenGL debug functionality.\n");
+        }
+    }
+#endif
+}
+
@@ -0,0 +1,1241 @@
+// IMPORTANT: must be included first or else the definitions will be exported
+#define OPENGL_DEFINE_FUNCTIONS
+#include "opengl.h"
+
+#include "thermal.h"
+#include "string2.h"
+#include "memory.h"
+#include "platform.h"
+#include "utf.h"
+#include "font.h"
+#include "io.h"
+
+#include <cstdlib>
+#include <cstdio>
+#include <climits>
+#include <clocale>
+#include <cerrno>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <ftw.h>
+#include <poll.h>
+#include <pthread.h>
+#include <pty.h>
+#include <execinfo.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/ioctl.h>
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#ifndef HEADLESS
+// NOTE: Xlib typedefs Font and defines KeyPress/KeyRelease as macros, both collide with our own types.
+#define Font X11Font
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/keysym.h>
+#undef Font
+#undef KeyPress
+#undef KeyRelease
+
+#define X11_KEY_PRESS   2
+#define X11_KEY_RELEASE 3
+#endif // HEADLESS
+
+
+INTERNAL MemoryBuffer allocate_memory_buffer(Allocator alloc, s64 size) {
+    MemoryBuffer buffer = {};
+    buffer.memory = (u8*)allocate(alloc, size);
+    buffer.used   = 0;
+    buffer.alloc  = size;
+
+    return buffer;
+}
+
+INTERNAL void free_memory_buffer(Allocator alloc, MemoryBuffer *buffer) {
+    deallocate(alloc, buffer->memory, buffer->alloc);
+
+    INIT_STRUCT(buffer);
+}
+
+
+PlatformConsole Console;
+
+#ifndef PLATFORM_CONSOLE_BUFFER_SIZE
+#define PLATFORM_CONSOLE_BUFFER_SIZE 4096
+#endif
+
+
+// NOTE: File descriptors are stored in the void* handles of the platform structs.
+INTERNAL s32 to_fd(void *handle) {
+    return (s32)(s64)handle;
+}
+
+INTERNAL void *from_fd(s32 fd) {
+    return (void*)(s64)fd;
+}
+
+
+INTERNAL void *cstd_alloc_func(void *, s64 size, void *old, s64) {
+    void *result = 0;
+
+    if (old) {
+        if (size) {
+            result = realloc(old, size);
+        } else {
+            free(old);
+        }
+    } else {
+        result = calloc(1, size);
+    }
+
+    return result;
+}
+
+Allocator CStdAllocator = {cstd_alloc_func, 0};
+
+// TODO: Thread safety... make TLS?
+Allocator DefaultAllocator;
+MemoryArena TemporaryStorage;
+
+Allocator default_allocator() {
+    return DefaultAllocator;
+}
+
+Allocator temporary_allocator() {
+    return make_arena_allocator(&TemporaryStorage);
+}
+
+s64 temporary_storage_mark() {
+    return TemporaryStorage.used;
+}
+
+void temporary_storage_rewind(s64 mark) {
+    TemporaryStorage.used = mark;
+}
+
+void reset_temporary_storage() {
+    TemporaryStorage.used = 0;
+}
+
+
+// Written to by platform_wake_main_thread, drained by platform_wait_for_events.
+INTERNAL s32 WakeFd = -1;
+// Everything the main thread sleeps on: the wake up event and, once there is a window, the X connection.
+INTERNAL s32 EventPollFd = -1;
+
+INTERNAL void watch_for_events(s32 fd) {
+    epoll_event event = {};
+    event.events  = EPOLLIN;
+    event.data.fd = fd;
+
+    if (epoll_ctl(EventPollFd, EPOLL_CTL_ADD, fd, &event) == -1) die("Could not watch for events.");
+}
+
+int main(int argc, char **argv) {
+    DefaultAllocator = CStdAllocator;
+
+    TemporaryStorage = allocate_arena(KILOBYTES(32));
+
+    // NOTE: The X input method only hands out utf8 text if the locale is set.
+    setlocale(LC_CTYPE, "");
+
+    WakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (WakeFd == -1) die("Could not create the wake up event.");
+
+    EventPollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (EventPollFd == -1) die("Could not create the event poll.");
+    watch_for_events(WakeFd);
+
+    PlatformFile standard_out_handle = {};
+    standard_out_handle.handle = from_fd(STDOUT_FILENO);
+    standard_out_handle.write_buffer = allocate_memory_buffer(DefaultAllocator, PLATFORM_CONSOLE_BUFFER_SIZE);
+    standard_out_handle.open   = true;
+
+    Console.out = &standard_out_handle;
+
+    Array<String> args = ALLOCATE_ARRAY(String, argc);
+    DEFER(destroy_array(&args));
+
+    for (int i = 0; i < argc; i += 1) {
+        args[i] = allocate_string(argv[i]);
+    }
+
+    s32 status = application_main(args);
+
+    for (int i = 0; i < argc; i += 1) {
+        destroy_string(&args[i]);
+    }
+
+    flush_write_buffer(Console.out);
+
+    close(EventPollFd);
+    close(WakeFd);
+
+    destroy(&TemporaryStorage);
+    free_memory_buffer(DefaultAllocator, &Console.out->write_buffer);
+
+    return status;
+}
+
+INTERNAL void show_message_box_and_crash(String message) {
+    print("Fatal Error: %S\n", message);
+    flush_write_buffer(Console.out);
+
+    abort();
+}
+
+
+PlatformFile platform_create_file_handle(String filename, u32 mode) {
+    int flags = 0;
+
+    switch (mode) {
+    case PLATFORM_FILE_READ: {
+        flags = O_RDONLY;
+    } break;
+
+    case PLATFORM_FILE_WRITE: {
+        flags = O_WRONLY | O_CREAT | O_TRUNC;
+    } break;
+
+    case PLATFORM_FILE_APPEND: {
+        // NOTE: O_APPEND moves to the end with every write, so writes of several processes
+        //       end up one after the other instead of overwriting each other.
+        flags = O_WRONLY | O_CREAT | O_APPEND;
+    } break;
+
+    default:
+        die("Unknown file mode.");
+    }
+
+    PlatformFile result = {};
+
+    s32 fd = open(temporary_c_string(filename), flags | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return result;
+    }
+
+    result.handle = from_fd(fd);
+    result.open   = true;
+
+    return result;
+}
+
+void platform_close_file_handle(PlatformFile *file) {
+    if (file->open) {
+        close(to_fd(file->handle));
+    }
+
+    INIT_STRUCT(file);
+}
+
+s64 platform_file_size(PlatformFile *file) {
+    struct stat info;
+    if (fstat(to_fd(file->handle), &info) == -1) return 0;
+
+    return info.st_size;
+}
+
+PlatformMappedFile platform_map_file(String filename) {
+    PlatformMappedFile result = {};
+
+    s32 fd = open(temporary_c_string(filename), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return result;
+    DEFER(close(fd));
+
+    struct stat info;
+    if (fstat(fd, &info) == -1 || info.st_size == 0) return result;
+
+    // NOTE: The mapping stays valid after the descriptor is closed.
+    void *memory = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (memory == MAP_FAILED) return result;
+
+    result.content = {(u8*)memory, info.st_size};
+
+    return result;
+}
+
+void platform_unmap_file(PlatformMappedFile *file) {
+    if (file->content.data) munmap(file->content.data, file->content.size);
+
+    INIT_STRUCT(file);
+}
+
+String platform_read(PlatformFile *file, u64 offset, void *buffer, s64 size) {
+    if (!file->open) return {};
+
+    ssize_t bytes_read = pread(to_fd(file->handle), buffer, size, offset);
+    if (bytes_read < 0) bytes_read = 0;
+
+    return {(u8*)buffer, bytes_read};
+}
+
+s64 platform_write(PlatformFile *file, u64 offset, void const *buffer, s64 size) {
+    if (!file->open) return 0;
+
+    s32 fd = to_fd(file->handle);
+
+    s64 written = 0;
+    while (written < size) {
+        ssize_t result;
+        // NOTE: ULLONG_MAX means the current position, which is the only option for pipes and terminals.
+        if (offset == ULLONG_MAX) result = write(fd, (u8*)buffer + written, size - written);
+        else                      result = pwrite(fd, (u8*)buffer + written, size - written, offset + written);
+
+        if (result == -1) {
+            if (errno == EINTR) continue;
+
+            break;
+        }
+
+        written += result;
+    }
+
+    return written;
+}
+
+s64 platform_write(PlatformFile *file, void const *buffer, s64 size) {
+    return platform_write(file, ULLONG_MAX, buffer, size);
+}
+
+void platform_create_directory(String path) {
+    mkdir(temporary_c_string(path), 0755);
+}
+
+INTERNAL int delete_directory_entry(char const *path, struct stat const *, int, struct FTW *) {
+    return remove(path);
+}
+
+void platform_delete_file_or_directory(String path) {
+    RESET_TEMP_STORAGE_ON_EXIT();
+
+    // NOTE: Children first, a directory can only be removed once it is empty.
+    nftw(temporary_c_string(path), delete_directory_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+b32 platform_rename_file(String from, String to) {
+    RESET_TEMP_STORAGE_ON_EXIT();
+
+    return rename(temporary_c_string(from), temporary_c_string(to)) == 0;
+}
+
+String read_entire_file(String file, u32 *status, Allocator alloc) {
+    RESET_TEMP_STORAGE_ON_EXIT();
+
+    s32 fd = open(temporary_c_string(file), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        if (status) *status = READ_ENTIRE_FILE_NOT_FOUND;
+
+        return {};
+    }
+    DEFER(close(fd));
+
+    struct stat info;
+    if (fstat(fd, &info) == -1) {
+        if (status) *status = READ_ENTIRE_FILE_READ_ERROR;
+
+        return {};
+    }
+
+    String result = {};
+
+    if (info.st_size) {
+        result = allocate_string(info.st_size, alloc);
+
+        s64 total = 0;
+        while (total != result.size) {
+            ssize_t bytes_read = read(fd, result.data + total, result.size - total);
+            if (bytes_read == -1 && errno == EINTR) continue;
+
+            if (bytes_read <= 0) {
+                if (status) *status = READ_ENTIRE_FILE_READ_ERROR;
+
+                destroy_string(&result, alloc);
+                return {};
+            }
+
+            total += bytes_read;
+        }
+    }
+    if (status) *status = READ_ENTIRE_FILE_OK;
+
+    return result;
+}
+
+b32 write_builder_to_file(StringBuilder *builder, String file) {
+    PlatformFile handle = platform_create_file_handle(file, PLATFORM_FILE_WRITE);
+    if (!handle.open) return false;
+
+    StringBuilderBlock *block = &builder->first;
+    while (block) {
+        platform_write(&handle, block->buffer, block->used);
+
+        block = block->next;
+    }
+
+    platform_close_file_handle(&handle);
+
+    return true;
+}
+
+
+b32 platform_is_relative_path(String path) {
+    return path.size == 0 || path.data[0] != '/';
+}
+
+b32 platform_change_directory(String path) {
+    return chdir(temporary_c_string(path)) == 0;
+}
+
+String platform_get_current_directory() {
+    char buffer[PATH_MAX];
+    if (!getcwd(buffer, PATH_MAX)) return {};
+
+    return allocate_string(buffer, temporary_allocator());
+}
+
+Array<String> platform_directory_listing(String path) {
+    DArray<String> listing = {};
+
+    char const *folder = ".";
+    if (path.size) folder = temporary_c_string(path);
+
+    DIR *dir = opendir(folder);
+    if (!dir) return listing;
+
+    Allocator alloc = default_allocator();
+
+    struct dirent *entry;
+    while ((entry = readdir(dir))) {
+        append(listing, allocate_string(entry->d_name, alloc));
+    }
+
+    closedir(dir);
+
+    return listing;
+}
+
+void platform_destroy_directory_listing(Array<String> *listing) {
+    for (s64 i = 0; i < listing->size; i += 1) {
+        destroy_string(&listing->memory[i]);
+    }
+    destroy_array(listing);
+}
+
+s64 platform_peak_memory_usage() {
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == -1) return 0;
+
+    // NOTE: Reported in kilobytes.
+    return (s64)usage.ru_maxrss * 1024;
+}
+
+void *platform_allocate_raw_memory(s64 size) {
+    void *result = calloc(1, size);
+    if (result == 0) show_message_box_and_crash("Could not allocate memory.");
+
+    return result;
+}
+
+void platform_free_raw_memory(void *memory) {
+    free(memory);
+}
+
+
+u32 const STACK_TRACE_SIZE = 64;
+
+INTERNAL void print_stack_trace() {
+    void *stack[STACK_TRACE_SIZE];
+
+    s32 frames = backtrace(stack, STACK_TRACE_SIZE);
+
+    flush_write_buffer(Console.out);
+    // NOTE: Needs -rdynamic for function names, addr2line resolves the rest.
+    backtrace_symbols_fd(stack + 2, frames - 2, STDOUT_FILENO);
+}
+
+void die(String msg) {
+    print("Fatal Error: %S\n\n", msg);
+    print_stack_trace();
+
+    abort();
+}
+
+void fire_assert(char const *msg, char const *func, char const *file, int line) {
+    print("Assertion failed: %s\n", msg);
+    print("\t%s\n\t%s:%d\n\n", file, func, line);
+
+    print_stack_trace();
+
+    abort();
+}
+
+
+// IMPORTANT(race_condition): this is not thread safe
+INTERNAL char PathBuffer[PATH_MAX];
+
+String platform_get_executable_path() {
+    s64 size = readlink("/proc/self/exe", PathBuffer, PATH_MAX);
+    if (size < 0) size = 0;
+
+    for (; size > 0; size -= 1) {
+        if (PathBuffer[size - 1] == '/') break;
+    }
+
+    return allocate_string({(u8*)PathBuffer, size}, temporary_allocator());
+}
+
+u32 platform_process_id() {
+    return getpid();
+}
+
+b32 platform_file_exists(String file) {
+    return access(temporary_c_string(file), F_OK) == 0;
+}
+
+#ifndef HEADLESS
+/*
+ * Main window creation process
+ */
+
+
+INTERNAL Display *MainDisplay;
+INTERNAL Window   MainWindow;
+INTERNAL Atom     WmDeleteWindow;
+
+INTERNAL XIM InputMethod;
+INTERNAL XIC InputContext;
+
+#include "linux_opengl.cpp"
+
+
+INTERNAL r32 WindowWidth;
+INTERNAL r32 WindowHeight;
+INTERNAL b32 WindowExposed;
+
+bool platform_setup_window() {
+    MainDisplay = XOpenDisplay(0);
+    if (!MainDisplay) show_message_box_and_crash("Could not connect to the X server.");
+    watch_for_events(ConnectionNumber(MainDisplay));
+
+    s32 screen = DefaultScreen(MainDisplay);
+    Window root = RootWindow(MainDisplay, screen);
+
+    GLXFBConfig config = choose_gl_config(MainDisplay, screen);
+    XVisualInfo *visual = glXGetVisualFromFBConfig(MainDisplay, config);
+    if (!visual) show_message_box_and_crash("Could not get a visual for the OpenGL config.");
+    DEFER(XFree(visual));
+
+    XSetWindowAttributes attributes = {};
+    attributes.colormap   = XCreateColormap(MainDisplay, root, visual->visual, AllocNone);
+    attributes.event_mask = ExposureMask | StructureNotifyMask | KeyPressMask | KeyReleaseMask |
+                            ButtonPressMask | ButtonReleaseMask | PointerMotionMask | FocusChangeMask;
+
+    s32 const width  = 1280;
+    s32 const height = 720;
+    MainWindow = XCreateWindow(MainDisplay, root, 0, 0, width, height, 0,
+                               visual->depth, InputOutput, visual->visual,
+                               CWColormap | CWEventMask, &attributes);
+
+    if (!MainWindow) show_message_box_and_crash("Could not create X11 window.");
+
+    XStoreName(MainDisplay, MainWindow, "Thermal");
+
+    WmDeleteWindow = XInternAtom(MainDisplay, "WM_DELETE_WINDOW", False);
+    XSetWMProtocols(MainDisplay, MainWindow, &WmDeleteWindow, 1);
+
+    XSetLocaleModifiers("");
+    InputMethod = XOpenIM(MainDisplay, 0, 0, 0);
+    if (!InputMethod) {
+        XSetLocaleModifiers("@im=none");
+        InputMethod = XOpenIM(MainDisplay, 0, 0, 0);
+    }
+    if (InputMethod) {
+        InputContext = XCreateIC(InputMethod, XNInputStyle, XIMPreeditNothing | XIMStatusNothing,
+                                 XNClientWindow, MainWindow, XNFocusWindow, MainWindow, (void*)0);
+    }
+
+    XMapWindow(MainDisplay, MainWindow);
+
+    WindowWidth  = width;
+    WindowHeight = height;
+
+    setup_gl_context(MainDisplay, MainWindow, config);
+    if (load_opengl_functions(load_gl_function) == 0) {
+        show_message_box_and_crash("Could not load opengl functions.");
+    }
+
+    return 0;
+}
+
+void platform_window_swap_buffers() {
+    glXSwapBuffers(MainDisplay, MainWindow);
+}
+
+// Wraps the string in single quotes so the shell passes it on unchanged.
+INTERNAL String shell_quote(String str) {
+    StringBuilder builder = {};
+    DEFER(destroy(&builder));
+
+    append(&builder, (u8)'\'');
+    for (s64 i = 0; i < str.size; i += 1) {
+        if (str[i] == '\'') append(&builder, "'\\''");
+        else                 append(&builder, str[i]);
+    }
+    append(&builder, (u8)'\'');
+
+    return to_allocated_string(&builder, temporary_allocator());
+}
+
+// NOTE: There is no toolkit to draw the dialog with, so the one of the desktop is started through
+//       zenity or kdialog. Like on win32 a directory is selected.
+String platform_file_selection_dialog(String path) {
+    RESET_TEMP_STORAGE_ON_EXIT();
+
+    String quoted = shell_quote(path);
+    String dialogs[] = {
+        t_format("zenity --file-selection --directory --filename=%S/ 2>/dev/null", quoted),
+        t_format("kdialog --getexistingdirectory %S 2>/dev/null", quoted),
+    };
+
+    for (s32 i = 0; i < (s32)ARRAY_SIZE(dialogs); i += 1) {
+        FILE *dialog = popen(temporary_c_string(dialogs[i]), "r");
+        if (!dialog) continue;
+
+        char selected[PATH_MAX];
+        s64 size = fread(selected, 1, sizeof(selected), dialog);
+        s32 status = pclose(dialog);
+
+        // NOTE: The shell exits with 127 if the dialog is not installed, then the next one is tried.
+        //       Anything else means the user made a choice or cancelled.
+        if (!WIFEXITED(status) || WEXITSTATUS(status) == 127) continue;
+        if (WEXITSTATUS(status) != 0) return {};
+
+        String result = {(u8*)selected, size};
+        while (result.size && (result[result.size - 1] == '\n' || result[result.size - 1] == '\r')) result.size -= 1;
+
+        return allocate_string(result, default_allocator());
+    }
+
+    LOG(LOG_ERROR, "Neither zenity nor kdialog is installed, no directory can be selected.\n");
+
+    return {};
+}
+#endif // HEADLESS
+
+// Set size to the next page boundry, else the mapping can not be done to the memory after the first block
+INTERNAL s32 ring_buffer_pages(s32 size) {
+    s64 page_size = sysconf(_SC_PAGESIZE);
+
+    return (size + page_size - 1) & ~(page_size - 1);
+}
+
+// Maps the first size bytes of the file twice in a row.
+INTERNAL void *map_ring_views(s32 fd, s32 size) {
+    u8 *placeholder = (u8*)mmap(0, (size_t)size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (placeholder == MAP_FAILED) return 0;
+
+    void *view1 = mmap(placeholder,        size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    void *view2 = mmap(placeholder + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+
+    if (view1 == MAP_FAILED || view2 == MAP_FAILED) {
+        munmap(placeholder, (size_t)size * 2);
+
+        return 0;
+    }
+
+    return placeholder;
+}
+
+INTERNAL b32 map_ring_buffer(PlatformRingBuffer *ring, s32 size) {
+    size = ring_buffer_pages(size);
+
+    s32 fd = memfd_create("thermal_ring", MFD_CLOEXEC);
+    if (fd == -1) return false;
+
+    void *memory = 0;
+    if (ftruncate(fd, size) != -1) memory = map_ring_views(fd, size);
+
+    if (!memory) {
+        close(fd);
+
+        return false;
+    }
+
+    INIT_STRUCT(ring);
+    ring->memory = memory;
+    ring->alloc  = size;
+
+    // NOTE: Kept open so the ring can grow in place, see platform_resize_ring_buffer.
+    ring->platform_data = from_fd(fd);
+
+    return true;
+}
+
+PlatformRingBuffer platform_create_ring_buffer(s32 size) {
+    PlatformRingBuffer ring = {};
+
+    if (!map_ring_buffer(&ring, size)) die("Could not map the ring buffer.");
+
+    return ring;
+}
+
+void platform_destroy_ring_buffer(PlatformRingBuffer *ring) {
+    if (!ring->memory) return;
+
+    munmap(ring->memory, (size_t)ring->alloc * 2);
+    close(to_fd(ring->platform_data));
+
+    INIT_STRUCT(ring);
+}
+
+b32 platform_resize_ring_buffer(PlatformRingBuffer *ring, s32 size) {
+    // NOTE: A ring whose contents don't wrap around grows by making the file bigger and mapping it
+    //       again. The bytes keep their offsets, so nothing is copied and the pages already in
+    //       use are not faulted in a second time.
+    s32 end = (ring->end == 0 && ring->size) ? ring->alloc : ring->end;
+    if (size > ring->alloc && end >= ring->size) {
+        size = ring_buffer_pages(size);
+
+        s32 fd = to_fd(ring->platform_data);
+        if (ftruncate(fd, size) == -1) return false;
+
+        void *memory = map_ring_views(fd, size);
+        if (!memory) return false;
+
+        munmap(ring->memory, (size_t)ring->alloc * 2);
+
+        ring->memory = memory;
+        ring->alloc  = size;
+        ring->end    = end;
+
+        return true;
+    }
+
+    PlatformRingBuffer new_ring = {};
+    if (!map_ring_buffer(&new_ring, size)) return false;
+
+    s32 keep = ring->size;
+    if (keep > new_ring.alloc) keep = new_ring.alloc;
+
+    // NOTE: Thanks to the second mapping the newest bytes are contiguous even if they wrap around.
+    u8 *src = (u8*)ring->memory + ring->end - keep;
+    if (src < (u8*)ring->memory) src += ring->alloc;
+
+    copy_memory(new_ring.memory, src, keep);
+
+    new_ring.size = keep;
+    new_ring.end  = keep;
+    if (new_ring.end == new_ring.alloc) new_ring.end = 0;
+
+    platform_destroy_ring_buffer(ring);
+    *ring = new_ring;
+
+    return true;
+}
+
+
+String platform_writable_range(PlatformRingBuffer *ring, s32 size, s32 offset) {
+    if (size > ring->alloc) size = ring->alloc;
+
+    u8 *mem = (u8*)ring->memory;
+
+    u8 *start;
+    if (offset) {
+        assert(offset <= ring->size);
+
+        start = mem + (ring->end - offset);
+        if (start < mem) start += ring->alloc;
+
+        s32 added_size = size - offset;
+        if (added_size > 0) {
+            ring->end  += added_size;
+            ring->size += added_size;
+        }
+    } else {
+        start = mem + ring->end;
+
+        ring->end  += size;
+        ring->size += size;
+    }
+
+    if (ring->end  > ring->alloc) ring->end -= ring->alloc;
+    if (ring->size > ring->alloc) ring->size = ring->alloc;
+
+    String range = {};
+    range.data = start;
+    range.size = size;
+
+    return range;
+}
+
+String platform_writable_range_inserted(PlatformRingBuffer *ring, s32 size, s32 offset) {
+    if (!offset) return platform_writable_range(ring, size);
+
+    assert(offset <= ring->size);
+
+    s32 writable_size = ring->alloc - offset;
+    if (size > writable_size) size = writable_size;
+
+    u8 *mem = (u8*)ring->memory;
+
+    u8 *start = mem + (ring->end - offset);
+    if (start < mem) start += ring->alloc;
+
+    copy_memory(start + size, start, offset);
+
+    String range = {};
+    range.data = start;
+    range.size = size;
+
+    ring->end  += size;
+    ring->size += size;
+
+    if (ring->end  > ring->alloc) ring->end -= ring->alloc;
+    if (ring->size > ring->alloc) ring->size = ring->alloc;
+
+    return range;
+}
+
+
+struct LinuxThreadData {
+    pthread_t handle;
+    b32 joined;
+};
+
+// NOTE: This function is needed as an intermediate between the os and the user function.
+INTERNAL void *linux_thread_proxy(void *data) {
+    PlatformThread *thread = (PlatformThread*)data;
+
+    thread->result = thread->func(thread->user_data);
+
+    return 0;
+}
+
+PlatformThread *platform_create_thread(PlatformThreadFunc *func, void *user_data) {
+    PlatformThread *thread = ALLOC(default_allocator(), PlatformThread, 1);
+    thread->func   = func;
+    thread->user_data = user_data;
+
+    LinuxThreadData *data = ALLOC(default_allocator(), LinuxThreadData, 1);
+
+    if (pthread_create(&data->handle, 0, linux_thread_proxy, thread) != 0) {
+        DEALLOC(default_allocator(), data, 1);
+        DEALLOC(default_allocator(), thread, 1);
+
+        return 0;
+    }
+
+    thread->platform_data = data;
+
+    return thread;
+}
+
+void platform_destroy_thread(PlatformThread *thread) {
+    LinuxThreadData *data = (LinuxThreadData*)thread->platform_data;
+
+    if (!data->joined) {
+        pthread_cancel(data->handle);
+        pthread_join(data->handle, 0);
+    }
+
+    DEALLOC(default_allocator(), data, 1);
+    DEALLOC(default_allocator(), thread, 1);
+}
+
+void platform_join_thread(PlatformThread *thread) {
+    LinuxThreadData *data = (LinuxThreadData*)thread->platform_data;
+
+    pthread_join(data->handle, 0);
+    data->joined = true;
+}
+
+r64 platform_get_time() {
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + time.tv_nsec * 1.0e-9;
+}
+
+void platform_sleep(s32 milliseconds) {
+    timespec time = {milliseconds / 1000, (milliseconds % 1000) * 1000000L};
+    nanosleep(&time, 0);
+}
+
+// NOTE: An eventfd counter behaves like an auto resetting event, reading it resets it to zero.
+PlatformEvent platform_create_event() {
+    PlatformEvent event = {};
+
+    s32 fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (fd == -1) die("Could not create an event.");
+    event.platform_data = from_fd(fd);
+
+    return event;
+}
+
+void platform_destroy_event(PlatformEvent *event) {
+    close(to_fd(event->platform_data));
+
+    INIT_STRUCT(event);
+}
+
+void platform_signal_event(PlatformEvent *event) {
+    u64 value = 1;
+    write(to_fd(event->platform_data), &value, sizeof(value));
+}
+
+b32 platform_wait_event(PlatformEvent *event, s32 milliseconds) {
+    pollfd poll_fd = {to_fd(event->platform_data), POLLIN, 0};
+    if (poll(&poll_fd, 1, milliseconds) <= 0) return false;
+
+    u64 value;
+    return read(poll_fd.fd, &value, sizeof(value)) == sizeof(value);
+}
+
+void platform_wake_main_thread() {
+    u64 value = 1;
+    write(WakeFd, &value, sizeof(value));
+}
+
+void platform_wait_for_events(r64 deadline) {
+#ifndef HEADLESS
+    // NOTE: Xlib may already have read events off the socket into its queue, the socket alone
+    //       would not wake us up for those.
+    if (MainDisplay) {
+        XFlush(MainDisplay);
+        if (XPending(MainDisplay)) return;
+    }
+#endif // HEADLESS
+
+    s32 timeout = -1;
+    if (deadline >= 0) {
+        r64 remaining = deadline - platform_get_time();
+        if (remaining <= 0) return;
+
+        // Rounded up, waking up early would only mean another round through the loop.
+        timeout = (s32)(remaining * 1000.0) + 1;
+    }
+
+    epoll_event events[4];
+    s32 count = epoll_wait(EventPollFd, events, ARRAY_SIZE(events), timeout);
+
+    for (s32 i = 0; i < count; i += 1) {
+        if (events[i].data.fd == WakeFd) {
+            u64 wake_count;
+            read(WakeFd, &wake_count, sizeof(wake_count));
+        }
+    }
+}
+
+PlatformExecutionContext platform_execute(String command, V2i size) {
+    PlatformExecutionContext context = {};
+
+    char const *c_command = temporary_c_string(command);
+
+    // NOTE: Children are not waited for if they outlive their output, collect them here.
+    while (waitpid(-1, 0, WNOHANG) > 0);
+
+    winsize window_size = {};
+    window_size.ws_col = (unsigned short)size.x;
+    window_size.ws_row = (unsigned short)size.y;
+
+    s32 master = -1;
+    pid_t pid = forkpty(&master, 0, 0, &window_size);
+    if (pid == -1) {
+        return context;
+    }
+
+    if (pid == 0) {
+        execl("/bin/sh", "sh", "-c", c_command, (char*)0);
+        _exit(127);
+    }
+
+    fcntl(master, F_SETFD, FD_CLOEXEC);
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    // NOTE: Input is typed into the prompt and echoed there, the pty would show it a second time.
+    termios attributes;
+    if (tcgetattr(master, &attributes) == 0) {
+        attributes.c_lflag &= ~(ECHO | ECHONL);
+        tcsetattr(master, TCSANOW, &attributes);
+    }
+
+    context.read_pipe      = from_fd(master);
+    context.process_handle = from_fd(pid);
+    context.started_successfully = true;
+
+    return context;
+}
+
+b32 platform_finished_execution(PlatformExecutionContext *pec) {
+    pid_t pid = to_fd(pec->process_handle);
+    if (pid == 0) return true;
+
+    pid_t result = waitpid(pid, 0, WNOHANG);
+    if (result == pid || (result == -1 && errno == ECHILD)) {
+        // NOTE: Once collected the pid can be handed out again, so it is not waited for a second time.
+        pec->process_handle = 0;
+
+        return true;
+    }
+
+    return false;
+}
+
+void platform_close_execution(PlatformExecutionContext *pec) {
+    if (pec->started_successfully) {
+        close(to_fd(pec->read_pipe));
+        if (pec->process_handle) waitpid(to_fd(pec->process_handle), 0, WNOHANG);
+    }
+
+    INIT_STRUCT(pec);
+}
+
+void platform_resize_execution(PlatformExecutionContext *pec, V2i size) {
+    winsize window_size = {};
+    window_size.ws_col = (unsigned short)size.x;
+    window_size.ws_row = (unsigned short)size.y;
+
+    // NOTE: The kernel sends SIGWINCH to the foreground process group of the pty.
+    if (ioctl(to_fd(pec->read_pipe), TIOCSWINSZ, &window_size) == -1) {
+        print("platform_resize_execution: Error code %d\n", errno);
+    }
+}
+
+u32 platform_input_available(PlatformExecutionContext *pec) {
+    int available = 0;
+    if (ioctl(to_fd(pec->read_pipe), FIONREAD, &available) == -1) {
+        print("platform_input_available: Error code %d\n", errno);
+    }
+
+    return available;
+}
+
+s32 platform_read(PlatformExecutionContext *pec, void *buffer, s32 size) {
+    s32 fd = to_fd(pec->read_pipe);
+
+    for (;;) {
+        ssize_t bytes_read = read(fd, buffer, size);
+        if (bytes_read >= 0) return bytes_read;
+
+        if (errno == EAGAIN) {
+            pollfd poll_fd = {fd, POLLIN, 0};
+            poll(&poll_fd, 1, -1);
+        } else if (errno != EINTR) {
+            // NOTE: The master side fails with EIO once the child closed the last slave descriptor.
+            return 0;
+        }
+    }
+}
+
+b32 platform_write_input(PlatformExecutionContext *pec, void const *buffer, s32 size) {
+    s32 fd = to_fd(pec->read_pipe);
+
+    s32 written = 0;
+    while (written < size) {
+        ssize_t result = write(fd, (u8*)buffer + written, size - written);
+        if (result >= 0) {
+            written += result;
+        } else if (errno == EAGAIN) {
+            // NOTE: This runs on the main thread, a child that reads no input must not freeze the window.
+            pollfd poll_fd = {fd, POLLOUT, 0};
+            if (poll(&poll_fd, 1, 1000) == 0) return false;
+        } else if (errno != EINTR) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+
+#ifndef HEADLESS
+INTERNAL V2  CurrentMousePosition;
+INTERNAL s32 CurrentMouseScroll;
+INTERNAL b32 LeftButtonHeld;
+
+INTERNAL b32 AltHeld;
+INTERNAL b32 CtrlHeld;
+INTERNAL b32 ShiftHeld;
+
+INTERNAL KeyPress KeyBuffer[KeyBufferSize];
+INTERNAL u32 KeyBufferUsed;
+
+INTERNAL void push_text(String text) {
+    while (text.size && KeyBufferUsed < KeyBufferSize) {
+        UTF8CharResult result = utf8_peek(text);
+        if (result.status != GET_OK) break;
+
+        text.data += result.length;
+        text.size -= result.length;
+
+        if (result.cp < 0x20 || result.cp == 0x7F) continue;
+
+        KeyPress key = {};
+        key.code_point = result.cp;
+
+        KeyBuffer[KeyBufferUsed] = key;
+        KeyBufferUsed += 1;
+    }
+}
+
+INTERNAL void handle_key_press(XKeyEvent *event) {
+    KeySym sym = XLookupKeysym(event, 0);
+
+    if (sym == XK_Alt_L || sym == XK_Alt_R) {
+        AltHeld = true;
+    } else if (sym == XK_Control_L || sym == XK_Control_R) {
+        CtrlHeld = true;
+    } else if (sym == XK_Shift_L || sym == XK_Shift_R) {
+        ShiftHeld = true;
+    }
+
+    if (KeyBufferUsed == KeyBufferSize) return;
+
+    KeyPress key = {};
+    if      (sym == XK_Return || sym == XK_KP_Enter) key.key = KEY_RETURN;
+    else if (sym == XK_BackSpace) key.key = KEY_BACKSPACE;
+    else if (sym == XK_Delete)    key.key = KEY_DELETE;
+    else if (sym == XK_Left)      key.key = KEY_LEFT_ARROW;
+    else if (sym == XK_Right)     key.key = KEY_RIGHT_ARROW;
+    else if (sym == XK_Home)      key.key = KEY_HOME;
+    else if (sym == XK_End)       key.key = KEY_END;
+
+    if (key.key) {
+        KeyBuffer[KeyBufferUsed] = key;
+        KeyBufferUsed += 1;
+
+        return;
+    }
+
+    char text[64];
+    if (InputContext) {
+        Status status = 0;
+        s32 length = Xutf8LookupString(InputContext, event, text, sizeof(text), 0, &status);
+        if (status != XLookupChars && status != XLookupBoth) return;
+
+        push_text({(u8*)text, length});
+    } else {
+        // NOTE: Without an input method the text is Latin-1, which maps directly to code points.
+        s32 length = XLookupString(event, text, sizeof(text), 0, 0);
+        for (s32 i = 0; i < length && KeyBufferUsed < KeyBufferSize; i += 1) {
+            u32 cp = (u8)text[i];
+            if (cp < 0x20 || cp == 0x7F) continue;
+
+            KeyPress text_key = {};
+            text_key.code_point = cp;
+
+            KeyBuffer[KeyBufferUsed] = text_key;
+            KeyBufferUsed += 1;
+        }
+    }
+}
+
+INTERNAL void handle_key_release(XKeyEvent *event) {
+    KeySym sym = XLookupKeysym(event, 0);
+
+    if (sym == XK_Alt_L || sym == XK_Alt_R) {
+        AltHeld = false;
+    } else if (sym == XK_Control_L || sym == XK_Control_R) {
+        CtrlHeld = false;
+    } else if (sym == XK_Shift_L || sym == XK_Shift_R) {
+        ShiftHeld = false;
+    }
+}
+
+void platform_update(ApplicationState *state) {
+    state->window_size_changed = false;
+    state->window_exposed      = false;
+
+    while (XPending(MainDisplay)) {
+        XEvent event;
+        XNextEvent(MainDisplay, &event);
+
+        if (XFilterEvent(&event, None)) continue;
+
+        switch (event.type) {
+        case ClientMessage: {
+            if ((Atom)event.xclient.data.l[0] == WmDeleteWindow) {
+                state->running = false;
+            }
+        } break;
+
+        case ConfigureNotify: {
+            WindowWidth  = event.xconfigure.width;
+            WindowHeight = event.xconfigure.height;
+        } break;
+
+        case Expose: {
+            WindowExposed = true;
+        } break;
+
+        case MotionNotify: {
+            CurrentMousePosition.x = (r32)event.xmotion.x;
+            CurrentMousePosition.y = (r32)event.xmotion.y;
+        } break;
+
+        case ButtonPress: {
+            if      (event.xbutton.button == Button1) LeftButtonHeld = true;
+            else if (event.xbutton.button == Button4) CurrentMouseScroll += 1;
+            else if (event.xbutton.button == Button5) CurrentMouseScroll -= 1;
+        } break;
+
+        case ButtonRelease: {
+            if (event.xbutton.button == Button1) LeftButtonHeld = false;
+        } break;
+
+        case FocusIn: {
+            if (InputContext) XSetICFocus(InputContext);
+        } break;
+
+        case FocusOut: {
+            if (InputContext) XUnsetICFocus(InputContext);
+
+            AltHeld   = false;
+            CtrlHeld  = false;
+            ShiftHeld = false;
+        } break;
+
+        case X11_KEY_PRESS: {
+            handle_key_press(&event.xkey);
+        } break;
+
+        case X11_KEY_RELEASE: {
+            handle_key_release(&event.xkey);
+        } break;
+        }
+    }
+
+    state->user_input.last_mouse = state->user_input.mouse;
+    state->user_input.mouse.cursor = CurrentMousePosition;
+    state->user_input.mouse.lmb    = LeftButtonHeld;
+    state->user_input.mouse.scroll = CurrentMouseScroll;
+
+    CurrentMouseScroll = 0;
+
+    state->user_input.alt_held   = AltHeld;
+    state->user_input.ctrl_held  = CtrlHeld;
+    state->user_input.shift_held = ShiftHeld;
+
+    copy_memory(state->user_input.key_buffer, KeyBuffer, KeyBufferUsed * sizeof(KeyPress));
+    state->user_input.key_buffer_used = KeyBufferUsed;
+    KeyBufferUsed = 0;
+
+    state->window_exposed = WindowExposed;
+    WindowExposed = false;
+
+    if (state->window_size.width != WindowWidth || state->window_size.height != WindowHeight) {
+        state->window_size.width  = WindowWidth;
+        state->window_size.height = WindowHeight;
+        state->window_aspect_ratio = WindowWidth / WindowHeight;
+
+        state->window_size_changed = true;
+    }
+}
+#endif // HEADLESS
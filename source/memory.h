@@ -3,6 +3,7 @@
 #include "definitions.h"
 
 #include <cstdlib>
+#include <cstring>
 
 
 #define INIT_STRUCT(ptr) zero_memory(ptr, sizeof(*ptr))
@@ -53,26 +54,13 @@ inline void zero_memory(void *data, s64 size) {
     for (s64 i = 0; i < size; i += 1) ptr[i] = 0;
 }
 
+// NOTE: Overlapping ranges are allowed.
 inline void copy_memory(void *dest, void const *src, s64 size) {
-    u8 *d = (u8*)dest;
-    u8 *s = (u8*)src;
-
-    if (d < s) {
-        for (s64 i = 0; i < size; i += 1) d[i] = s[i];
-    } else {
-        for (s64 i = size - 1; i > -1; i -= 1) d[i] = s[i];
-    }
+    memmove(dest, src, size);
 }
 
 inline bool memory_is_equal(void const *lhs, void const *rhs, u64 size) {
-    u8 *l = (u8*)lhs;
-    u8 *r = (u8*)rhs;
-
-    for (s64 i = 0; i < size; i += 1) {
-        if (l[i] != r[i]) return false;
-    }
-
-    return true;
+    return memcmp(lhs, rhs, size) == 0;
 }
 
 inline MemoryArena allocate_arena(s64 size) {
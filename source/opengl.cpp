@@ -19,6 +19,8 @@ INTERNAL bool load_opengl_functions(OpenGLLoadFunc *load) {
     LOAD(GL_BIND_BUFFER_BASE_FUNC, glBindBufferBase);
     LOAD(GL_BUFFER_DATA_FUNC, glBufferData);
     LOAD(GL_BUFFER_SUB_DATA_FUNC, glBufferSubData);
+    LOAD(GL_MAP_BUFFER_RANGE_FUNC, glMapBufferRange);
+    LOAD(GL_UNMAP_BUFFER_FUNC, glUnmapBuffer);
     LOAD(GL_VERTEX_ATTRIB_POINTER_FUNC, glVertexAttribPointer);
     LOAD(GL_ENABLE_VERTEX_ATTRIB_ARRAY_FUNC, glEnableVertexAttribArray);
     LOAD(GL_USE_PROGRAM_FUNC, glUseProgram);
@@ -37,6 +39,8 @@ INTERNAL bool load_opengl_functions(OpenGLLoadFunc *load) {
     LOAD(GL_GET_ATTRIB_LOCATION_FUNC, glGetAttribLocation);
     LOAD(GL_GET_UNIFORM_BLOCK_INDEX_FUNC, glGetUniformBlockIndex);
     LOAD(GL_UNIFORM_BLOCK_BINDING_FUNC, glUniformBlockBinding);
+    LOAD(GL_UNIFORM_1I_FUNC, glUniform1i);
+    LOAD(GL_UNIFORM_2F_FUNC, glUniform2f);
     LOAD(GL_GET_SHADER_IV_FUNC, glGetShaderiv);
     LOAD(GL_GET_SHADER_INFO_LOG_FUNC, glGetShaderInfoLog);
     LOAD(GL_GET_PROGRAM_IV_FUNC, glGetProgramiv);
@@ -47,7 +51,10 @@ INTERNAL bool load_opengl_functions(OpenGLLoadFunc *load) {
     LOAD(GL_TEX_STORAGE_2D_FUNC, glTexStorage2D);
     LOAD(GL_COMPRESSED_TEX_SUB_IMAGE_2D_FUNC, glCompressedTexSubImage2D);
     LOAD(GL_TEX_IMAGE_2D_FUNC, glTexImage2D);
+    LOAD(GL_TEX_SUB_IMAGE_2D_FUNC, glTexSubImage2D);
+    LOAD(GL_PIXEL_STORE_I_FUNC, glPixelStorei);
     LOAD(GL_TEX_PARAMETER_I_FUNC, glTexParameteri);
+    LOAD(GL_TEX_BUFFER_FUNC, glTexBuffer);
     LOAD(GL_GENERATE_MIPMAP_FUNC, glGenerateMipmap);
 
     LOAD(GL_DEPTH_FUNC_FUNC, glDepthFunc);
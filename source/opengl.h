@@ -75,6 +75,15 @@
 
 #define GL_UNIFORM_BUFFER   0x8A11
 
+#define GL_PIXEL_UNPACK_BUFFER  0x88EC
+#define GL_UNPACK_ROW_LENGTH    0x0CF2
+#define GL_UNPACK_ALIGNMENT     0x0CF5
+#define GL_MAP_WRITE_BIT              0x0002
+#define GL_MAP_INVALIDATE_BUFFER_BIT  0x0008
+
+#define GL_TEXTURE_BUFFER   0x8C2A
+#define GL_RGBA32UI         0x8D70
+
 #define GL_TEXTURE0        0x84C0
 #define GL_TEXTURE1        0x84C1
 #define GL_TEXTURE2        0x84C2
@@ -127,6 +136,8 @@ typedef void OPENGL_CALL GL_BIND_BUFFER_FUNC(GLenum, GLuint); OPENGL_EXTERN GL_B
 typedef void OPENGL_CALL GL_BIND_BUFFER_BASE_FUNC(GLenum, GLuint, GLuint); OPENGL_EXTERN GL_BIND_BUFFER_BASE_FUNC *glBindBufferBase;
 typedef void OPENGL_CALL GL_BUFFER_DATA_FUNC(GLuint, GLsizeiptr, void const*, GLenum); OPENGL_EXTERN GL_BUFFER_DATA_FUNC *glBufferData;
 typedef void OPENGL_CALL GL_BUFFER_SUB_DATA_FUNC(GLenum, GLintptr, GLsizeiptr, void const*); OPENGL_EXTERN GL_BUFFER_SUB_DATA_FUNC *glBufferSubData;
+typedef void* OPENGL_CALL GL_MAP_BUFFER_RANGE_FUNC(GLenum, GLintptr, GLsizeiptr, GLbitfield); OPENGL_EXTERN GL_MAP_BUFFER_RANGE_FUNC *glMapBufferRange;
+typedef GLboolean OPENGL_CALL GL_UNMAP_BUFFER_FUNC(GLenum); OPENGL_EXTERN GL_UNMAP_BUFFER_FUNC *glUnmapBuffer;
 typedef void OPENGL_CALL GL_VERTEX_ATTRIB_POINTER_FUNC(GLuint, GLuint, GLenum, GLboolean, GLsizei, void const*); OPENGL_EXTERN GL_VERTEX_ATTRIB_POINTER_FUNC *glVertexAttribPointer;
 typedef void OPENGL_CALL GL_ENABLE_VERTEX_ATTRIB_ARRAY_FUNC(GLuint); OPENGL_EXTERN GL_ENABLE_VERTEX_ATTRIB_ARRAY_FUNC *glEnableVertexAttribArray;
 typedef void OPENGL_CALL GL_USE_PROGRAM_FUNC(GLuint); OPENGL_EXTERN GL_USE_PROGRAM_FUNC *glUseProgram;
@@ -145,6 +156,8 @@ typedef GLint OPENGL_CALL GL_GET_UNIFORM_LOCATION_FUNC(GLuint, GLchar const*); O
 typedef GLint OPENGL_CALL GL_GET_ATTRIB_LOCATION_FUNC(GLuint, GLchar const*); OPENGL_EXTERN GL_GET_ATTRIB_LOCATION_FUNC *glGetAttribLocation;
 typedef GLuint OPENGL_CALL GL_GET_UNIFORM_BLOCK_INDEX_FUNC(GLuint, GLchar const*); OPENGL_EXTERN GL_GET_UNIFORM_BLOCK_INDEX_FUNC *glGetUniformBlockIndex;
 typedef void OPENGL_CALL GL_UNIFORM_BLOCK_BINDING_FUNC(GLuint, GLuint, GLuint); OPENGL_EXTERN GL_UNIFORM_BLOCK_BINDING_FUNC *glUniformBlockBinding;
+typedef void OPENGL_CALL GL_UNIFORM_1I_FUNC(GLint, GLint); OPENGL_EXTERN GL_UNIFORM_1I_FUNC *glUniform1i;
+typedef void OPENGL_CALL GL_UNIFORM_2F_FUNC(GLint, GLfloat, GLfloat); OPENGL_EXTERN GL_UNIFORM_2F_FUNC *glUniform2f;
 typedef void OPENGL_CALL GL_GET_SHADER_IV_FUNC(GLuint, GLenum, GLint*); OPENGL_EXTERN GL_GET_SHADER_IV_FUNC *glGetShaderiv;
 typedef void OPENGL_CALL GL_GET_SHADER_INFO_LOG_FUNC(GLuint, GLsizei, GLsizei*, GLchar*); OPENGL_EXTERN GL_GET_SHADER_INFO_LOG_FUNC *glGetShaderInfoLog;
 typedef void OPENGL_CALL GL_GET_PROGRAM_IV_FUNC(GLuint, GLenum, GLint*); OPENGL_EXTERN GL_GET_PROGRAM_IV_FUNC *glGetProgramiv;
@@ -154,9 +167,12 @@ typedef void OPENGL_CALL GL_DELETE_TEXTURES_FUNC(GLsizei, GLuint*); OPENGL_EXTER
 typedef void OPENGL_CALL GL_ACTIVE_TEXTURE_FUNC(GLenum); OPENGL_EXTERN GL_ACTIVE_TEXTURE_FUNC *glActiveTexture;
 typedef void OPENGL_CALL GL_BIND_TEXTURE_FUNC(GLenum, GLuint); OPENGL_EXTERN GL_BIND_TEXTURE_FUNC *glBindTexture;
 typedef void OPENGL_CALL GL_TEX_IMAGE_2D_FUNC(GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, void const*); OPENGL_EXTERN GL_TEX_IMAGE_2D_FUNC *glTexImage2D;
+typedef void OPENGL_CALL GL_TEX_SUB_IMAGE_2D_FUNC(GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, void const*); OPENGL_EXTERN GL_TEX_SUB_IMAGE_2D_FUNC *glTexSubImage2D;
+typedef void OPENGL_CALL GL_PIXEL_STORE_I_FUNC(GLenum, GLint); OPENGL_EXTERN GL_PIXEL_STORE_I_FUNC *glPixelStorei;
 typedef void OPENGL_CALL GL_COMPRESSED_TEX_SUB_IMAGE_2D_FUNC(GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLsizei, void const*); OPENGL_EXTERN GL_COMPRESSED_TEX_SUB_IMAGE_2D_FUNC *glCompressedTexSubImage2D;
 typedef void OPENGL_CALL GL_TEX_STORAGE_2D_FUNC(GLenum, GLsizei, GLenum, GLsizei, GLsizei); OPENGL_EXTERN GL_TEX_STORAGE_2D_FUNC *glTexStorage2D;
 typedef void OPENGL_CALL GL_TEX_PARAMETER_I_FUNC(GLenum, GLenum, GLint); OPENGL_EXTERN GL_TEX_PARAMETER_I_FUNC *glTexParameteri;
+typedef void OPENGL_CALL GL_TEX_BUFFER_FUNC(GLenum, GLenum, GLuint); OPENGL_EXTERN GL_TEX_BUFFER_FUNC *glTexBuffer;
 typedef void OPENGL_CALL GL_GENERATE_MIPMAP_FUNC(GLenum); OPENGL_EXTERN GL_GENERATE_MIPMAP_FUNC *glGenerateMipmap;
 
 typedef void OPENGL_CALL GL_DEPTH_FUNC_FUNC(GLenum); OPENGL_EXTERN GL_DEPTH_FUNC_FUNC *glDepthFunc;
@@ -36,6 +36,15 @@ struct GPUTexture {
     GLuint id;
     GLenum format;
     V2i size;
+
+    GLuint upload_buffer; // Pixel buffer for update_gpu_texture_regions, created on first use.
+};
+
+// A buffer the shader reads with texelFetch, for data that doesn't fit the vertex per vertex layout.
+struct GPUTextureBuffer {
+    GLuint buffer;
+    GLuint texture;
+    GLenum format;
 };
 
 struct RendererBackend {
@@ -80,6 +80,107 @@ void update_gpu_texture(GPUTexture *tex, String pixel_data) {
     glTexImage2D(GL_TEXTURE_2D, 0, tex->format, tex->size.width, tex->size.height, 0, tex->format, GL_UNSIGNED_BYTE, pixel_data.data);
 }
 
+INTERNAL s32 bytes_per_pixel(GLenum format) {
+    switch (format) {
+    case GL_RED:  return 1;
+    case GL_RG:   return 2;
+    case GL_RGB:  return 3;
+    case GL_RGBA: return 4;
+    }
+
+    die("Unsupported texture format.");
+    return 0;
+}
+
+void update_gpu_texture_regions(GPUTexture *tex, String pixel_data, Array<Rect2i> regions) {
+    if (regions.size == 0) return;
+
+    s32 pixel_size = bytes_per_pixel(tex->format);
+    s64 row_pitch  = tex->size.width * pixel_size;
+
+    s64 total_size = 0;
+    FOR (regions, region) {
+        total_size += region->width * region->height * pixel_size;
+    }
+
+    if (tex->upload_buffer == 0) glGenBuffers(1, &tex->upload_buffer);
+
+    // NOTE: Reallocating the storage orphans the old one. If the GPU still copies from it
+    //       the driver hands out new memory instead of making us wait.
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, tex->upload_buffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, total_size, 0, GL_STREAM_DRAW);
+
+    u8 *mapped = (u8*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, total_size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+    glBindTexture(GL_TEXTURE_2D, tex->id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if (mapped) {
+        // The regions are packed tightly, one after another.
+        u8 *dest = mapped;
+        FOR (regions, region) {
+            s64 region_pitch = region->width * pixel_size;
+            u8 *source = pixel_data.data + region->y * row_pitch + region->x * pixel_size;
+
+            for (s32 row = 0; row < region->height; row += 1) {
+                copy_memory(dest, source, region_pitch);
+                dest   += region_pitch;
+                source += row_pitch;
+            }
+        }
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        s64 offset = 0;
+        FOR (regions, region) {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, region->x, region->y, region->width, region->height, tex->format, GL_UNSIGNED_BYTE, (void*)offset);
+            offset += region->width * region->height * pixel_size;
+        }
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    } else {
+        // Synchronous fallback straight out of the pixel data.
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, tex->size.width);
+
+        FOR (regions, region) {
+            u8 *source = pixel_data.data + region->y * row_pitch + region->x * pixel_size;
+            glTexSubImage2D(GL_TEXTURE_2D, 0, region->x, region->y, region->width, region->height, tex->format, GL_UNSIGNED_BYTE, source);
+        }
+
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void create_gpu_texture_buffer(GPUTextureBuffer *buffer) {
+    buffer->format = GL_RGBA32UI;
+
+    glGenBuffers(1, &buffer->buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer->buffer);
+    glBufferData(GL_TEXTURE_BUFFER, 0, 0, GL_STREAM_DRAW);
+
+    glGenTextures(1, &buffer->texture);
+    glBindTexture(GL_TEXTURE_BUFFER, buffer->texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, buffer->format, buffer->buffer);
+}
+
+void update_gpu_texture_buffer(GPUTextureBuffer *buffer, void *data, u32 size) {
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer->buffer);
+    glBufferData(GL_TEXTURE_BUFFER, size, data, GL_STREAM_DRAW);
+}
+
+void update_gpu_texture_buffer_range(GPUTextureBuffer *buffer, u32 offset, void *data, u32 size) {
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer->buffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, offset, size, data);
+}
+
+void use_texture_buffer(Renderer *renderer, GPUTextureBuffer *buffer, u32 unit) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_BUFFER, buffer->texture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
 void create_gpu_shader(GPUShader *shader, String name) {
     shader->id = load_shader(name);
 }
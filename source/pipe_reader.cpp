@@ -0,0 +1,118 @@
+#include "pipe_reader.h"
+
+#include "atomic.h"
+#include "memory.h"
+#include "io.h"
+
+
+s64 const PipeReaderCapacity = MEGABYTES(4);
+
+// NOTE: The timeout only guards against a missed signal, normally the main thread wakes us up.
+s32 const PipeReaderWaitTimeout = 100;
+
+
+INTERNAL s32 pipe_reader_thread(void *data) {
+    PipeReader *reader = (PipeReader*)data;
+    u8 *memory = (u8*)reader->ring.memory;
+    s64 mask   = reader->capacity - 1;
+
+    for (;;) {
+        s64 write_pos = reader->write_pos;
+        s64 read_pos  = atomic_load_acquire(&reader->read_pos);
+
+        s64 free = reader->capacity - (write_pos - read_pos);
+        if (free == 0) {
+            platform_wait_event(&reader->space_available, PipeReaderWaitTimeout);
+            continue;
+        }
+
+        // NOTE: Thanks to the second mapping the free space never wraps around.
+        s32 read = platform_read(&reader->pec, memory + (write_pos & mask), (s32)free);
+        if (read <= 0) break;
+
+        atomic_store_release(&reader->write_pos, write_pos + read);
+
+        // NOTE: The main thread only needs a wake up if it could have seen the ring empty.
+        //       read_pos is loaded again after the barrier, else the main thread could consume
+        //       everything and go to sleep between our first load and the store above.
+        //       pipe_reader_pending does the same from the other side.
+        atomic_full_barrier();
+        if (atomic_load_acquire(&reader->read_pos) == write_pos) {
+            atomic_store_release(&reader->output_time, (s64)(platform_get_time() * 1000000.0));
+            platform_wake_main_thread();
+        }
+    }
+
+    atomic_store_release(&reader->finished, true);
+    platform_wake_main_thread();
+
+    return 0;
+}
+
+b32 start_pipe_reader(PipeReader *reader, PlatformExecutionContext pec) {
+    assert(reader->thread == 0);
+
+    if (reader->ring.memory == 0) {
+        reader->ring     = platform_create_ring_buffer(PipeReaderCapacity);
+        reader->capacity = reader->ring.alloc;
+        assert((reader->capacity & (reader->capacity - 1)) == 0);
+
+        reader->space_available = platform_create_event();
+    }
+
+    reader->pec       = pec;
+    reader->write_pos = 0;
+    reader->read_pos  = 0;
+    reader->finished  = false;
+    reader->output_time = 0;
+
+    reader->thread = platform_create_thread(pipe_reader_thread, reader);
+    if (reader->thread == 0) {
+        LOG(LOG_ERROR, "Could not start the pipe reader thread.\n");
+        platform_close_execution(&reader->pec);
+
+        return false;
+    }
+
+    return true;
+}
+
+void stop_pipe_reader(PipeReader *reader) {
+    assert(atomic_load_acquire(&reader->finished));
+
+    platform_join_thread(reader->thread);
+    platform_destroy_thread(reader->thread);
+    reader->thread = 0;
+
+    platform_close_execution(&reader->pec);
+}
+
+String pipe_reader_peek(PipeReader *reader) {
+    s64 write_pos = atomic_load_acquire(&reader->write_pos);
+    s64 read_pos  = reader->read_pos;
+
+    s64 offset = read_pos & (reader->capacity - 1);
+
+    String result = {(u8*)reader->ring.memory + offset, write_pos - read_pos};
+
+    return result;
+}
+
+void pipe_reader_consume(PipeReader *reader, s64 size) {
+    if (size == 0) return;
+
+    atomic_store_release(&reader->read_pos, reader->read_pos + size);
+    platform_signal_event(&reader->space_available);
+}
+
+b32 pipe_reader_done(PipeReader *reader) {
+    if (!atomic_load_acquire(&reader->finished)) return false;
+
+    return atomic_load_acquire(&reader->write_pos) == reader->read_pos;
+}
+
+b32 pipe_reader_pending(PipeReader *reader) {
+    atomic_full_barrier();
+
+    return atomic_load_acquire(&reader->write_pos) != reader->read_pos || atomic_load_acquire(&reader->finished);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "definitions.h"
+#include "platform.h"
+
+
+// Drains the output of a child process on its own thread, so the child never waits for a frame
+// to be rendered. The bytes are handed to the main thread through a single producer/single
+// consumer ring. Only the reader thread writes write_pos and only the main thread writes read_pos.
+//
+// The ring is mapped twice in a row, so the free and the filled part are always contiguous.
+// The pipe is read straight into it and the main thread parses it in place.
+struct PipeReader {
+    PlatformExecutionContext pec;
+    PlatformThread *thread;
+
+    PlatformRingBuffer ring; // Only the mapping is used, the positions are tracked below.
+    s64 capacity; // NOTE: Needs to be a power of two.
+
+    s64 volatile write_pos;
+    s64 volatile read_pos;
+    s32 volatile finished;
+
+    // platform_get_time in microseconds of the last write into an empty ring, used to measure
+    // how long it takes until the output is on screen.
+    s64 volatile output_time;
+
+    PlatformEvent space_available; // Signaled by the main thread after consuming.
+};
+
+b32 start_pipe_reader(PipeReader *reader, PlatformExecutionContext pec);
+// Waits for the reader thread and closes the process handles. Only call once it is done.
+void stop_pipe_reader(PipeReader *reader);
+
+inline b32 pipe_reader_running(PipeReader *reader) {
+    return reader->thread != 0;
+}
+
+// Returns all bytes that were not consumed yet. Call pipe_reader_consume after they are processed,
+// the memory is reused afterwards.
+String pipe_reader_peek(PipeReader *reader);
+void pipe_reader_consume(PipeReader *reader, s64 size);
+
+// True when the child closed its end of the pipe and everything was consumed.
+b32 pipe_reader_done(PipeReader *reader);
+
+// True if there is output left to consume. Call before the main thread goes to sleep,
+// if it returns false the reader thread is guaranteed to wake it up for new output.
+b32 pipe_reader_pending(PipeReader *reader);
@@ -35,9 +35,22 @@ String platform_read(PlatformFile *file, u64 offset, void *buffer, s64 size);
 s64    platform_write(PlatformFile *file, void const *buffer, s64 size);
 s64    platform_write(PlatformFile *file, u64 offset, void const *buffer, s64 size);
 
+// Read only view of a whole file, for assets like fonts. Pages are only loaded when they are touched.
+// On failure content is empty.
+struct PlatformMappedFile {
+    String content;
+};
+
+PlatformMappedFile platform_map_file(String filename);
+void platform_unmap_file(PlatformMappedFile *file);
+
 void platform_create_directory(String path);
 void platform_delete_file_or_directory(String path);
 
+// Replaces an existing destination in one step, so other processes see either the old or the
+// new file and never a partially written one. Files mapped by others stay valid.
+b32 platform_rename_file(String from, String to);
+
 b32 write_builder_to_file(struct StringBuilder *builder, String file);
 
 
@@ -57,6 +70,9 @@ struct PlatformConsole {
 extern PlatformConsole Console;
 
 
+// Highest amount of physical memory the process used so far, in bytes.
+s64 platform_peak_memory_usage();
+
 void *platform_allocate_raw_memory(s64 size);
 void  platform_free_raw_memory(void *ptr);
 
@@ -65,9 +81,11 @@ void platform_window_swap_buffers();
 void platform_update(struct ApplicationState *state);
 
 String platform_get_executable_path();
+u32 platform_process_id();
 b32 platform_file_exists(String file);
 
 
+// Lets the user pick a directory, starting at path. Empty if the dialog was cancelled or can not be shown.
 String platform_file_selection_dialog(String path);
 
 
@@ -76,10 +94,19 @@ struct PlatformRingBuffer {
     s32 size;
     s32 alloc;
     s32 end;
+
+    void *platform_data;
 };
 
 
 PlatformRingBuffer platform_create_ring_buffer(s32 size);
+void platform_destroy_ring_buffer(PlatformRingBuffer *ring);
+
+// Maps a new ring with the given size and moves the contents over.
+// If the new ring is smaller only the newest bytes are kept. A platform may grow the ring in place
+// instead, .end is updated either way.
+// On failure the ring is left untouched and false is returned.
+b32 platform_resize_ring_buffer(PlatformRingBuffer *ring, s32 size);
 
 // Returns the next writable area in the buffer and advances .end accordingly.
 // If the requested size is bigger than .alloc the returned range will be smaller than size
@@ -111,12 +138,36 @@ struct PlatformThread {
 
 PlatformThread *platform_create_thread(PlatformThreadFunc *func, void *user_data);
 void platform_destroy_thread(PlatformThread *thread);
-void platform_join_thread(PlatformThread thread);
+void platform_join_thread(PlatformThread *thread);
+
+
+// Seconds since some arbitrary point, only useful for measuring durations.
+r64 platform_get_time();
+void platform_sleep(s32 milliseconds);
+
+
+// Auto resetting, a wait consumes the signal.
+struct PlatformEvent {
+    void *platform_data;
+};
+
+PlatformEvent platform_create_event();
+void platform_destroy_event(PlatformEvent *event);
+void platform_signal_event(PlatformEvent *event);
+// Returns false on timeout.
+b32 platform_wait_event(PlatformEvent *event, s32 milliseconds);
+
+// Can be called from any thread to make the main thread process a frame.
+void platform_wake_main_thread();
+// Blocks the main thread until there are window events, platform_wake_main_thread was called
+// or the deadline (in platform_get_time seconds) has passed. A negative deadline waits forever.
+void platform_wait_for_events(r64 deadline);
 
 
 // NOTE: I want to replace the win32 nonesense with a hand tailored include.
 struct PlatformExecutionContext {
     void *read_pipe;
+    void *write_pipe; // Input of the child. Unused on linux, the pty is read and written through read_pipe.
 
     void *thread_handle;
     void *process_handle;
@@ -124,10 +175,19 @@ struct PlatformExecutionContext {
     u32 started_successfully;
 };
 
-PlatformExecutionContext platform_execute(String command);
+// Size is the grid in columns and rows the child sees as its terminal.
+PlatformExecutionContext platform_execute(String command, V2i size);
+// Only checks whether the process exited, the handles stay open until platform_close_execution.
 b32 platform_finished_execution(PlatformExecutionContext *pec);
+// Closes the handles without waiting for the process. The only place they are closed.
+void platform_close_execution(PlatformExecutionContext *pec);
+// Tells the child the new grid size in columns and rows, like platform_execute does at the start.
+void platform_resize_execution(PlatformExecutionContext *pec, V2i size);
 u32 platform_input_available(PlatformExecutionContext *pec);
+// Blocks until there is output. Returns 0 once the child closed its end of the pipe.
 s32 platform_read(PlatformExecutionContext *pec, void *buffer, s32 size);
+// Sends input to the child. Returns false if the child is gone or does not take the input within a second.
+b32 platform_write_input(PlatformExecutionContext *pec, void const *buffer, s32 size);
 
 s32 application_main(Array<String> args);
 
@@ -73,9 +73,18 @@ void update_gpu_buffer(GPUBuffer *buffer, void *vertex_buffer, u32 buffer_size);
 
 void create_gpu_texture(GPUTexture *tex, V2i dimensions, u32 channels, String pixel_data, GPUTextureFlags flags = GPU_TEXTURE_FLAGS_NONE);
 void update_gpu_texture(GPUTexture *tex, String pixel_data);
+// Only uploads the given regions. pixel_data covers the whole texture, like with update_gpu_texture.
+void update_gpu_texture_regions(GPUTexture *tex, String pixel_data, Array<Rect2i> regions);
 
 void use_texture(Renderer *renderer, GPUTexture *texture);
 
+// Elements are four u32 each.
+void create_gpu_texture_buffer(GPUTextureBuffer *buffer);
+void update_gpu_texture_buffer(GPUTextureBuffer *buffer, void *data, u32 size);
+// Overwrites part of the buffer, the size of the buffer stays the same.
+void update_gpu_texture_buffer_range(GPUTextureBuffer *buffer, u32 offset, void *data, u32 size);
+void use_texture_buffer(Renderer *renderer, GPUTextureBuffer *buffer, u32 unit);
+
 void create_gpu_shader(GPUShader *shader, String name);
 
 void render(Renderer *renderer, RenderTask *task);
@@ -250,6 +250,21 @@ inline Array<String> split_by_line_ending(String text, Allocator alloc = tempora
     return lines;
 }
 
+// Only plain decimal digits, no sign. Returns false if anything else is in the string.
+inline b32 parse_s64(String str, s64 *result) {
+    if (str.size == 0) return false;
+
+    s64 value = 0;
+    for (s64 i = 0; i < str.size; i += 1) {
+        if (str.data[i] < '0' || str.data[i] > '9') return false;
+
+        value = value * 10 + (str.data[i] - '0');
+    }
+    *result = value;
+
+    return true;
+}
+
 struct SplitResult {
     String first;
     String second;
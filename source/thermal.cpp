@@ -6,408 +6,11 @@
 #include "font.h"
 #include "renderer.h"
 #include "ui.h"
+#include "atomic.h"
 
 #include "ansi_escape_parser.h"
-    
 
 
-s32 const DefaultConsoleBufferSize = KILOBYTES(4);
-
-
-V2i local_cursor_pos(ConsoleBuffer *buffer) {
-    V2i result = {};
-    if (buffer->lines.size > buffer->tile_count.y) {
-        result.y = (buffer->scrollback_cursor.y + buffer->tile_count.y + buffer->scroll_offset) - buffer->lines.size;
-    } else {
-        result.y = buffer->scrollback_cursor.y;
-    }
-
-    result.x = buffer->scrollback_cursor.x; // TODO: - horizontal scroll_offset;
-
-    return result;
-}
-
-INTERNAL Array<ConsoleTile> console_buffer_content(ConsoleBuffer *buffer) {
-    u8 *end = (u8*)buffer->ring.memory + buffer->ring.end;
-    u8 *ptr = end - buffer->ring.size;
-
-    if (ptr < buffer->ring.memory) ptr += buffer->ring.alloc;
-
-    Array<ConsoleTile> result = {};
-    result.memory = (ConsoleTile*)(ptr);
-    result.size   = buffer->ring.size / sizeof(ConsoleTile);
-
-    return result;
-}
-
-INTERNAL b32 eat_new_line(Array<ConsoleTile> content, s64 *index) {
-    s64 i = *index;
-    b32 result = false;
-
-    if (content[i].cp == '\n') {
-        i += 1;
-        if (i < content.size && content[i].cp == '\r') i += 1;
-
-        result = true;
-    } else if (content[i].cp == '\r') {
-        i += 1;
-        if (i < content.size && content[i].cp == '\n') i += 1;
-
-        result = true;
-    }
-
-    *index = i;
-
-    return result;
-}
-
-INTERNAL u8 *end_ptr(ConsoleBuffer *buffer) {
-    return (u8*)buffer->ring.memory + buffer->ring.end;
-}
-
-INTERNAL s32 offset_from_pointer(ConsoleBuffer *buffer, void *ptr) {
-    u8 *p = (u8*)ptr;
-
-    u8 *end = (u8*)buffer->ring.memory + buffer->ring.end;
-    if (end < p) {
-        end += buffer->ring.alloc;
-    }
-
-    assert(p <= end);
-    return end - p;
-}
-
-void update_lines(ConsoleBuffer *buffer) {
-    buffer->lines.size = 0;
-
-    Array<ConsoleTile> content = console_buffer_content(buffer);
-
-    LineInfo info = {content.memory, 0};
-
-    LineInfo *current_line = append(buffer->lines, info);
-
-    ConsoleTile *cursor_ptr = (ConsoleTile*)(end_ptr(buffer) - buffer->write_offset);
-    for (s64 i = 0; i < content.size; i += 1) {
-        if (content.memory + i == cursor_ptr) {
-            buffer->scrollback_cursor.x = current_line->line.size;
-            buffer->scrollback_cursor.y = buffer->lines.size - 1;
-        }
-
-        if (eat_new_line(content, &i) ) {
-            info.line.memory = content.memory + i;
-            info.line.size = 0;
-            current_line = append(buffer->lines, info);
-
-            i -= 1;
-        } else if (buffer->line_wrap && current_line->line.size == buffer->tile_count.x) {
-            info.line.memory = content.memory + i;
-            info.line.size = 1;
-            current_line = append(buffer->lines, info);
-
-        } else {
-            current_line->line.size += 1;
-        }
-    }
-
-    if (content.memory + content.size == cursor_ptr) {
-        buffer->scrollback_cursor.x = current_line->line.size;
-        buffer->scrollback_cursor.y = buffer->lines.size - 1;
-    }
-}
-
-INTERNAL Array<LineInfo> visible_lines(ConsoleBuffer *buffer) {
-    s32 line_count = buffer->tile_count.y - 1;
-
-    if (buffer->lines.size < line_count) {
-        return buffer->lines;
-    }
-
-    s64 index = buffer->lines.size - (line_count + buffer->scroll_offset);
-    Array<LineInfo> result = {};
-    result.memory = buffer->lines.memory + index;
-    result.size   = line_count;
-
-    return result;
-}
-
-void update_display_buffer(ConsoleBuffer *buffer) {
-    s32 line_count = buffer->tile_count.y;
-    if (line_count < 1) return;
-
-    if (buffer->tile_count.x * line_count != buffer->display_buffer.size) {
-        prealloc(buffer->display_buffer, buffer->tile_count.x * line_count);
-    }
-
-    FOR (buffer->display_buffer, tile) {
-        INIT_STRUCT(tile);
-    }
-
-    Array<LineInfo> lines = visible_lines(buffer);
-    
-    s32 line = 0;
-    FOR (lines, info) {
-        s64 size = info->line.size;
-        if (size > buffer->tile_count.x) size = buffer->tile_count.x;
-
-        copy_memory(&buffer->display_buffer[line * buffer->tile_count.x], info->line.memory, size * sizeof(ConsoleTile));
-        line += 1;
-    }
-}
-
-INTERNAL Array<ConsoleTile> current_line(ConsoleBuffer *buffer) {
-    return buffer->lines[buffer->scrollback_cursor.y].line;
-}
-
-INTERNAL void flush_conversion_buffer(ConsoleBuffer *buffer, s32 count) {
-    u8 *ptr  = (u8*)buffer->conversion_buffer.memory;
-    s64 size = count * sizeof(ConsoleTile);
-
-    auto *write_func = platform_writable_range;
-
-    if (buffer->write_offset) {
-        s32 override_range = current_line(buffer).size - buffer->scrollback_cursor.x;
-        if (override_range) {
-            if (override_range > size) override_range = size;
-
-            String range = platform_writable_range(&buffer->ring, size, buffer->write_offset);
-            copy_memory(range.data, ptr, range.size);
-
-            size -= range.size;
-            ptr  += range.size;
-
-            buffer->write_offset = offset_from_pointer(buffer, range.data + range.size);
-
-            if (size == 0) return;
-        }
-
-        write_func = platform_writable_range_inserted;
-    }
-
-    String range = write_func(&buffer->ring, size, buffer->write_offset);
-
-    while (size) {
-        assert(size % sizeof(ConsoleTile) == 0);
-
-        copy_memory(range.data, ptr, range.size);
-        buffer->write_offset = offset_from_pointer(buffer, range.data + range.size);
-
-        ptr  += range.size;
-        size -= range.size;
-
-        range = write_func(&buffer->ring, size, buffer->write_offset);
-    }
-}
-
-u32 const DefaultTileFlags = 0;
-
-INTERNAL void change_buffer_graphics(ConsoleBuffer *buffer, EscapeSequence seq) {
-    for (s32 i = 0; i < seq.arg_count; i += 1) {
-        switch (seq.args[i]) {
-        case ESCAPE_CSI_RESET: {
-           buffer->current_fg = buffer->fg_color;
-           buffer->current_bg = buffer->bg_color;
-           buffer->current_tile_flags = DefaultTileFlags;
-        } break;
-
-        case ESCAPE_CSI_SET_BOLD: buffer->current_tile_flags |= CONSOLE_TILE_FLAG_BOLD; break;
-
-        case ESCAPE_CSI_FOREGROUND: {
-            assert(i + 1 < seq.arg_count);
-
-            if (seq.args[i + 1] == 5) {
-                assert(i + 2 < seq.arg_count);
-                assert(seq.args[i + 2] < 256);
-
-                buffer->current_fg = ansi_8bit_color(seq.args[i + 2]);
-
-                i += 1;
-            } else if (seq.args[i + 1] == 2) {
-                assert(i + 4 < seq.arg_count);
-
-                s32 r = seq.args[i + 2];
-                s32 g = seq.args[i + 3];
-                s32 b = seq.args[i + 4];
-                assert(r < 256);
-                assert(g < 256);
-                assert(b < 256);
-
-                buffer->current_fg = PACK_RGB(r, g, b);
-
-                i += 3;
-            } else {
-                LOG(LOG_ERROR, "Unsupported foreground color sequence.");
-            }
-        } break;
-
-        case ESCAPE_CSI_BACKGROUND: {
-        } break;
-
-        case ESCAPE_CSI_FOREGROUND_BLACK:
-        case ESCAPE_CSI_FOREGROUND_RED:
-        case ESCAPE_CSI_FOREGROUND_GREEN:
-        case ESCAPE_CSI_FOREGROUND_YELLOW:
-        case ESCAPE_CSI_FOREGROUND_BLUE:
-        case ESCAPE_CSI_FOREGROUND_MAGENTA:
-        case ESCAPE_CSI_FOREGROUND_CYAN:
-        case ESCAPE_CSI_FOREGROUND_WHITE:
-        case ESCAPE_CSI_FOREGROUND_BRIGHT_BLACK:
-        case ESCAPE_CSI_FOREGROUND_BRIGHT_RED:
-        case ESCAPE_CSI_FOREGROUND_BRIGHT_GREEN:
-        case ESCAPE_CSI_FOREGROUND_BRIGHT_YELLOW:
-        case ESCAPE_CSI_FOREGROUND_BRIGHT_BLUE:
-        case ESCAPE_CSI_FOREGROUND_BRIGHT_MAGENTA:
-        case ESCAPE_CSI_FOREGROUND_BRIGHT_CYAN:
-        case ESCAPE_CSI_FOREGROUND_BRIGHT_WHITE:
-            buffer->current_fg = ansi_4bit_color(seq.args[i]);
-        break;
-
-        case ESCAPE_CSI_BACKGROUND_BLACK:
-        case ESCAPE_CSI_BACKGROUND_RED:
-        case ESCAPE_CSI_BACKGROUND_GREEN:
-        case ESCAPE_CSI_BACKGROUND_YELLOW:
-        case ESCAPE_CSI_BACKGROUND_BLUE:
-        case ESCAPE_CSI_BACKGROUND_MAGENTA:
-        case ESCAPE_CSI_BACKGROUND_CYAN:
-        case ESCAPE_CSI_BACKGROUND_WHITE:
-        case ESCAPE_CSI_BACKGROUND_BRIGHT_BLACK:
-        case ESCAPE_CSI_BACKGROUND_BRIGHT_RED:
-        case ESCAPE_CSI_BACKGROUND_BRIGHT_GREEN:
-        case ESCAPE_CSI_BACKGROUND_BRIGHT_YELLOW:
-        case ESCAPE_CSI_BACKGROUND_BRIGHT_BLUE:
-        case ESCAPE_CSI_BACKGROUND_BRIGHT_MAGENTA:
-        case ESCAPE_CSI_BACKGROUND_BRIGHT_CYAN:
-        case ESCAPE_CSI_BACKGROUND_BRIGHT_WHITE:
-            buffer->current_bg = ansi_4bit_color(seq.args[i]);
-        break;
-        }
-    }
-}
-
-enum CursorMovement {
-    MOVE_UP,
-    MOVE_DOWN,
-    MOVE_LEFT,
-    MOVE_RIGHT,
-};
-INTERNAL void move_scrollback_cursor(ConsoleBuffer *buffer, CursorMovement direction, s32 amount) {
-    V2i local_cursor = local_cursor_pos(buffer);
-
-    if (direction == MOVE_UP) {
-        if (local_cursor.y - amount < 0) amount = local_cursor.y;
-        buffer->scrollback_cursor.y -= amount;
-    } else if (direction == MOVE_DOWN) {
-        if (local_cursor.y + amount > buffer->tile_count.y) amount = buffer->tile_count.y - local_cursor.y;
-        buffer->scrollback_cursor.y += amount;
-    } else if (direction == MOVE_LEFT) {
-        if (local_cursor.x - amount < 0) amount = local_cursor.x;
-        buffer->scrollback_cursor.x -= amount;
-    } else if (direction == MOVE_RIGHT) {
-        if (local_cursor.x + amount > buffer->tile_count.x) amount = buffer->tile_count.x - local_cursor.x;
-        buffer->scrollback_cursor.x += amount;
-    }
-
-    if (buffer->line_wrap && buffer->scrollback_cursor.x > buffer->tile_count.x) {
-        buffer->scrollback_cursor.x = buffer->tile_count.x;
-    }
-
-    LineInfo *line = &buffer->lines[buffer->scrollback_cursor.y];
-    if (line->line.size < buffer->scrollback_cursor.x) {
-        ConsoleTile space = {};
-        space.cp = ' ';
-
-        LineInfo *info = &buffer->lines[buffer->scrollback_cursor.y];
-        s32 write_offset = offset_from_pointer(buffer, info->line.memory + info->line.size);
-
-        // TODO: Only add spaces if there will actually be an insertion?
-        s32 additional_tiles = (buffer->scrollback_cursor.x - line->line.size);
-        String range = platform_writable_range_inserted(&buffer->ring, additional_tiles * sizeof(ConsoleTile), write_offset);
-
-        ConsoleTile *mem = (ConsoleTile*)range.data;
-        for (s32 i = 0; i < additional_tiles; i += 1) {
-            mem[i] = space;
-        }
-
-        info->line.size += additional_tiles;
-    }
-
-    buffer->write_offset = offset_from_pointer(buffer, buffer->lines[buffer->scrollback_cursor.y].line.memory + buffer->scrollback_cursor.x);
-}
-
-INTERNAL void append(ConsoleBuffer *buffer, String str) {
-    s32 conversion_count = 0;
-
-    // TODO: SIMD scan over the buffer.
-
-    while (str.size) {
-        EscapeSequence seq = parse_escape_sequence(str);
-        if (seq.valid) {
-            flush_conversion_buffer(buffer, conversion_count);
-            update_lines(buffer);
-
-            str = shrink_front(str, seq.length_in_bytes);
-            conversion_count = 0;
-
-            if (seq.kind == 'm') {
-                change_buffer_graphics(buffer, seq);
-            } else if (seq.kind == 'K') {
-                // TODO: erase to end of line, start of line and whole line
-            } else if (seq.kind == 'A') {
-                if (seq.args[0] == 0) seq.args[0] = 1;
-
-                move_scrollback_cursor(buffer, MOVE_UP, seq.args[0]);
-            } else if (seq.kind == 'B') {
-                if (seq.args[0] == 0) seq.args[0] = 1;
-
-                move_scrollback_cursor(buffer, MOVE_DOWN, seq.args[0]);
-            } else if (seq.kind == 'C') {
-                if (seq.args[0] == 0) seq.args[0] = 1;
-
-                move_scrollback_cursor(buffer, MOVE_RIGHT, seq.args[0]);
-            } else if (seq.kind == 'D') {
-                if (seq.args[0] == 0) seq.args[0] = 1;
-
-                move_scrollback_cursor(buffer, MOVE_LEFT, seq.args[0]);
-            }
-        } else {
-            UTF8CharResult c = utf8_peek(str);
-            assert(c.status == 0);
-
-            buffer->conversion_buffer[conversion_count].cp = c.cp;
-            buffer->conversion_buffer[conversion_count].fg = buffer->current_fg;
-            buffer->conversion_buffer[conversion_count].bg = buffer->current_bg;
-
-            u32 style = CONSOLE_FONT_REGULAR;
-            if ((buffer->current_tile_flags & CONSOLE_TILE_FLAGS_BOLD_ITALIC) == CONSOLE_TILE_FLAGS_BOLD_ITALIC) {
-                style = CONSOLE_FONT_BOLD_ITALIC;
-            } else if (buffer->current_tile_flags & CONSOLE_TILE_FLAG_BOLD) {
-                style = CONSOLE_FONT_BOLD;
-            } else if (buffer->current_tile_flags & CONSOLE_TILE_FLAG_ITALIC) {
-                style = CONSOLE_FONT_ITALIC;
-            }
-            buffer->conversion_buffer[conversion_count].style = style;
-
-            conversion_count += 1;
-
-            if (conversion_count == buffer->conversion_buffer.size) {
-                flush_conversion_buffer(buffer, conversion_count);
-                conversion_count = 0;
-            }
-
-            str = shrink_front(str, c.length);
-        }
-    }
-    flush_conversion_buffer(buffer, conversion_count);
-
-    update_lines(buffer);
-    update_display_buffer(buffer);
-}
-
-INTERNAL void move_cursor_to_end(ConsoleBuffer *buffer) {
-    buffer->scrollback_cursor.y = buffer->lines.size - 1;
-    buffer->scrollback_cursor.x = buffer->lines[buffer->scrollback_cursor.y].line.size;
-
-    buffer->write_offset = 0;
-}
 
 INTERNAL void generate_prompt(PromptBuffer *prompt, ApplicationState *state) {
     prompt->buffer_used = 0;
@@ -473,6 +76,68 @@ INTERNAL String ANSICursorTest =
 ;
 
 
+INTERNAL void print_scrollback_config(ConsoleBuffer *buffer) {
+    ScrollbackConfig *config = &buffer->scrollback;
+
+    append(buffer, t_format("scrollback: %D lines in %D bytes, limit %D lines and %D bytes (0 is none)\n",
+                            scrollback_line_count(buffer), scrollback_memory(buffer), config->max_lines, config->max_bytes));
+}
+
+INTERNAL b32 has_user_input(UserInput *input) {
+    return input->key_buffer_used || input->mouse.scroll || input->mouse.lmb != input->last_mouse.lmb;
+}
+
+INTERNAL void print_glyph_cache_stats(ConsoleBuffer *buffer, ConsoleFont *font) {
+    ConsoleAtlasOccupancy occupancy = font_atlas_occupancy(font);
+
+    append(buffer, t_format("glyph cache: %D hits, %D misses, %D evictions\n", font->hits, font->misses, font->evictions));
+    append(buffer, t_format("atlas: %d glyphs (%d wide) in %d of %d cells, %d of %d shelves, %d cut off\n",
+                            occupancy.glyphs, occupancy.wide_glyphs, occupancy.cells_used, occupancy.cells_total,
+                            occupancy.shelves_used, occupancy.shelves_total, occupancy.cut_off));
+}
+
+// Time from the reader thread seeing new output after being idle until that output was on screen.
+struct OutputLatency {
+    s64 pending_since; // Microseconds, 0 if no output waits for a frame.
+    s64 last_seen;
+
+    s64 count;
+    s64 total;
+    s64 max;
+    s64 last;
+};
+
+INTERNAL void track_output(OutputLatency *latency, PipeReader *reader) {
+    s64 output_time = atomic_load_acquire(&reader->output_time);
+    if (output_time == latency->last_seen) return;
+
+    latency->last_seen = output_time;
+    if (!latency->pending_since) latency->pending_since = output_time;
+}
+
+INTERNAL void frame_presented(OutputLatency *latency) {
+    if (!latency->pending_since) return;
+
+    s64 now = (s64)(platform_get_time() * 1000000.0);
+    s64 elapsed = now - latency->pending_since;
+    latency->pending_since = 0;
+
+    latency->count += 1;
+    latency->total += elapsed;
+    latency->last   = elapsed;
+    if (elapsed > latency->max) latency->max = elapsed;
+}
+
+INTERNAL void print_output_latency(ConsoleBuffer *buffer, OutputLatency *latency) {
+    if (latency->count == 0) {
+        append(buffer, "No output was measured yet.\n");
+        return;
+    }
+
+    append(buffer, t_format("output to frame: %D frames, last %D us, average %D us, max %D us\n",
+                            latency->count, latency->last, latency->total / latency->count, latency->max));
+}
+
 s32 application_main(Array<String> args) {
     String starting_dir = platform_get_current_directory();
 
@@ -487,6 +152,12 @@ s32 application_main(Array<String> args) {
     ConsoleFont c_font = {};
     init(&c_font, 20.0f, t_format("%S/fonts", state.data_dir), "LiterationMono");
 
+    String cache_dir = t_format("%S/cache", state.data_dir);
+    platform_create_directory(cache_dir);
+    load_glyph_cache(&c_font, cache_dir);
+
+    start_glyph_workers(&c_font, 2);
+
 
 
     Renderer renderer = {};
@@ -495,45 +166,31 @@ s32 application_main(Array<String> args) {
 
     M4 projection_2D;
 
-    String liberation_mono = read_entire_file("data/fonts/LiterationMonoNerdFontMono-Regular.ttf");
-    DEFER(destroy_string(&liberation_mono));
     Font font = {};
-    init(&font, 20.0f, liberation_mono);
+    init(&font, &c_font);
 
+    // NOTE: The texture holds the console font atlas, later glyphs are uploaded region by region.
     GPUTexture font_texture = {};
-    create_gpu_texture(&font_texture, {FONT_ATLAS_DIMENSION, FONT_ATLAS_DIMENSION}, 1, font.atlas, GPU_TEXTURE_FLAGS_NONE);
+    create_gpu_texture(&font_texture, {FONT_ATLAS_DIMENSION, FONT_ATLAS_DIMENSION}, 1, c_font.atlas, GPU_TEXTURE_FLAGS_NONE);
+    clear_atlas_changes(&c_font);
 
     UIState ui = {};
     init_ui(&ui, &font);
     ui.font_texture = &font_texture;
 
     ConsoleBuffer buffer = {};
-    buffer.ring = platform_create_ring_buffer(DefaultConsoleBufferSize);
-    assert(buffer.ring.alloc % sizeof(ConsoleTile) == 0);
-
+    init(&buffer);
     buffer.font = &c_font;
 
-    buffer.fg_color  = PACK_RGB(210, 210, 210);
-    buffer.bg_color  = 0;
-
-    buffer.current_fg = buffer.fg_color;
-    buffer.current_bg = buffer.bg_color;
-
-    buffer.line_wrap = true;
-    buffer.pipe_buffer = ALLOCATE_ARRAY(u8, MEGABYTES(16));
-
-    buffer.conversion_buffer = ALLOCATE_ARRAY(ConsoleTile, 1024);
-    assert((sizeof(*buffer.conversion_buffer.memory) * buffer.conversion_buffer.size) < buffer.ring.alloc);
-
     buffer.prompt.format = "%d > ";
     generate_prompt(&buffer.prompt, &state);
 
+    OutputLatency latency = {};
+    b32 glyphs_prewarmed = false;
 
     while (state.running) {
         platform_update(&state);
 
-        clear_background(&renderer);
-
         if (state.window_size_changed) {
             update_render_area(&renderer, state.window_size);
 
@@ -541,14 +198,76 @@ s32 application_main(Array<String> args) {
             update_2D_projection(&renderer, projection_2D);
         }
 
+        if (pipe_reader_running(&buffer.reader)) {
+            track_output(&latency, &buffer.reader);
+
+            // NOTE: The reader thread keeps filling the ring in the meantime, so the child
+            //       only waits if a whole ring worth of output is pending. At most one ring
+            //       is processed per frame, so a fast child can't starve the rendering.
+            s64 consumed = 0;
+
+            String output = pipe_reader_peek(&buffer.reader);
+            while (output.size && consumed < buffer.reader.capacity) {
+                append(&buffer, output);
+                pipe_reader_consume(&buffer.reader, output.size);
+                consumed += output.size;
+
+                output = pipe_reader_peek(&buffer.reader);
+            }
+
+            if (pipe_reader_done(&buffer.reader)) stop_pipe_reader(&buffer.reader);
+        }
+
+        // NOTE: Once per frame for all the output above and whatever the last frame appended.
+        update_display_buffer(&buffer);
+
+        // NOTE: Glyphs from the workers only change the atlas, the cells already point at them.
+        apply_rasterized_glyphs(&c_font);
+
+        // NOTE: Frames are only drawn when something changed. The swap is skipped as well,
+        //       so the last frame stays on screen.
+        r64 next_ui_frame = ui_next_frame_time(&ui);
+
+        b32 frame_needed = state.window_size_changed || state.window_exposed || has_user_input(&state.user_input) ||
+                           buffer.damaged || c_font.is_dirty || (next_ui_frame >= 0 && next_ui_frame <= platform_get_time());
+        if (!frame_needed) {
+            // NOTE: Output that did not change the screen still has to be consumed before sleeping,
+            //       the reader thread only wakes us up when it finds the ring empty.
+            if (!pipe_reader_running(&buffer.reader) || !pipe_reader_pending(&buffer.reader)) {
+                platform_wait_for_events(next_ui_frame);
+            }
+
+            reset_temporary_storage();
+            continue;
+        }
+
+        clear_background(&renderer);
+
+        next_font_frame(&c_font);
         begin_frame(&ui, state.window_size, &state.user_input);
 
         b32 command_run = console_buffer_view(&ui, &buffer, &buffer);
-        if (command_run) {
+        if (command_run && pipe_reader_running(&buffer.reader)) {
+            // NOTE: While a command runs, entered lines are its input. They are echoed like the
+            //       terminal would, right after whatever the command printed last.
+            String32 utf32_input = {buffer.command.memory, buffer.command.size};
+            String input = to_utf8(temporary_allocator(), utf32_input);
+
+            buffer.scroll_offset = 0;
+            buffer.command.size  = 0;
+
+            append(&buffer, input);
+            append(&buffer, "\n");
+
+            String line = t_format("%S\n", input);
+            if (!platform_write_input(&buffer.reader.pec, line.data, (s32)line.size)) {
+                append(&buffer, "The command does not take any input.\n");
+            }
+        } else if (command_run) {
             buffer.current_fg = buffer.fg_color;
             buffer.current_bg = buffer.bg_color;
             buffer.current_tile_flags = 0;
-            buffer.write_offset = 0;
+            update_current_style(&buffer);
 
             String32 utf32_command = {buffer.command.memory, buffer.command.size};
 
@@ -562,7 +281,7 @@ s32 application_main(Array<String> args) {
 
                 String32 utf32_prompt = {buffer.prompt.buffer, buffer.prompt.buffer_used};
 
-                if (buffer.lines.size && buffer.lines[buffer.lines.size - 1].line.size != 0) {
+                if (buffer.screen.cursor.x != 0) {
                     append(&buffer, "\n");
                 }
 
@@ -594,12 +313,28 @@ s32 application_main(Array<String> args) {
                     append(&buffer, ANSIColorTest);
                 } else if (command == "ansi_cursor") {
                     append(&buffer, ANSICursorTest);
+                } else if (command == "scrollback") {
+                    print_scrollback_config(&buffer);
+                } else if (starts_with(command, "scrollback ")) {
+                    ScrollbackConfig config;
+                    if (parse_scrollback_config(shrink_front(command, 11), &config)) {
+                        set_scrollback(&buffer, config);
+                        print_scrollback_config(&buffer);
+                    } else {
+                        append(&buffer, "Expected a limit like \"10000 lines\" or \"64 mb\".\n");
+                    }
+                } else if (command == "latency") {
+                    print_output_latency(&buffer, &latency);
+                } else if (command == "glyph_cache") {
+                    print_glyph_cache_stats(&buffer, &c_font);
                 } else {
-                    buffer.pec = platform_execute(command);
+                    PlatformExecutionContext pec = platform_execute(command, screen_size(&buffer));
 
-                    if (!buffer.pec.started_successfully) {
+                    if (!pec.started_successfully) {
                         String message = "Error running command.\n";
                         append(&buffer, message);
+                    } else {
+                        start_pipe_reader(&buffer.reader, pec);
                     }
                 }
             }
@@ -611,28 +346,26 @@ s32 application_main(Array<String> args) {
             generate_prompt(&buffer.prompt, &state);
         }
 
-        if (buffer.pec.started_successfully) {
-            u32 pending = platform_input_available(&buffer.pec);
-            while (pending) {
-                s32 read = platform_read(&buffer.pec, buffer.pipe_buffer.memory, buffer.pipe_buffer.size);
-                append(&buffer, {buffer.pipe_buffer.memory, read});
-
-                pending = platform_input_available(&buffer.pec);
-            }
-        }
-
         if (c_font.is_dirty) {
-            update_gpu_texture(&font_texture, c_font.atlas);
-
-            c_font.is_dirty = false;
+            update_gpu_texture_regions(&font_texture, c_font.atlas, c_font.dirty_regions);
+            clear_atlas_changes(&c_font);
         }
 
         draw_ui(&renderer, &ui);
         platform_window_swap_buffers();
+        frame_presented(&latency);
+
+        // NOTE: Done after the first frame so it does not delay the window showing up.
+        if (!glyphs_prewarmed) {
+            prewarm_glyphs(&c_font);
+            glyphs_prewarmed = true;
+        }
 
         reset_temporary_storage();
     }
 
+    stop_glyph_workers(&c_font);
+    save_glyph_cache(&c_font);
     destroy_renderer(&renderer);
 
     return 0;
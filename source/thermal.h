@@ -5,6 +5,7 @@
 #include "string2.h"
 #include "io.h"
 #include "font.h"
+#include "console.h"
 
 
 enum Key {
@@ -49,6 +50,7 @@ struct ApplicationState {
     V2  window_size;
     r32 window_aspect_ratio;
     b32 window_size_changed;
+    b32 window_exposed; // The window contents were lost, e.g. after being uncovered, and need a redraw.
 
     Path current_dir;
 
@@ -56,78 +58,3 @@ struct ApplicationState {
 
     b32 running;
 };
-
-
-u32 const PROMPT_BUFFER_SIZE = 128;
-enum PromtKind {
-    PROMPT_STATIC,
-    PROMPT_UPDATE_EACH_COMMAND,
-    // PROMPT_UPDATE_EACH_FRAME,
-};
-struct PromptBuffer {
-    PromtKind kind;
-    u32 buffer[PROMPT_BUFFER_SIZE];
-    u32 buffer_used;
-
-    String format;
-};
-
-enum {
-    CONSOLE_TILE_FLAG_BOLD   = 0x01,
-    CONSOLE_TILE_FLAG_ITALIC = 0x02,
-
-    CONSOLE_TILE_FLAGS_BOLD_ITALIC = CONSOLE_TILE_FLAG_BOLD | CONSOLE_TILE_FLAG_ITALIC,
-};
-struct ConsoleTile {
-    u32 cp;
-    u32 style;
-    u32 fg;
-    u32 bg;
-};
-
-struct LineInfo {
-    Array<ConsoleTile> line;
-};
-
-struct ConsoleBuffer {
-    PlatformRingBuffer ring;
-    s32 write_offset;
-
-    s32 scroll_offset;
-    V2i scrollback_cursor; // .x is the column and .y is the line.
-
-    DArray<LineInfo> lines;
-    DArray<ConsoleTile> display_buffer;
-
-    DArray<u32> command;
-    s32 cursor_pos;
-    Array<String32> history;
-    
-    PromptBuffer prompt;
-
-    Array<u8> pipe_buffer;
-
-    Array<ConsoleTile> conversion_buffer;
-
-    ConsoleFont *font;
-
-    u32 fg_color;
-    u32 bg_color;
-
-    u32 current_tile_flags;
-    u32 current_fg;
-    u32 current_bg;
-
-    b32 line_wrap;
-
-    V2i tile_count;
-
-    PlatformExecutionContext pec;
-};
-
-
-V2i local_cursor_pos(ConsoleBuffer *buffer);
-
-void update_lines(ConsoleBuffer *buffer);
-void update_display_buffer(ConsoleBuffer *buffer);
-
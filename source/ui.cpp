@@ -22,14 +22,6 @@ INTERNAL void add_vertex(UIState *ui, UIVertex vertex) {
     last(window->tasks)->count += 1;
 }
 
-INTERNAL void add_text_vertex(UIState *ui, UITextVertex vertex) {
-    UIWindow *window = ui->current_window;
-    assert(window->tasks.size != 0);
-
-    append(ui->text_vertices, vertex);
-    last(window->tasks)->count += 1;
-}
-
 INTERNAL b32 mouse_released(UIState *ui) {
     return ui->input.last_mouse.lmb && !ui->input.mouse.lmb;
 }
@@ -184,15 +176,17 @@ void init_ui(UIState *ui, Font *font) {
     ui->default_window.ui = ui;
     ui->current_window    = &ui->default_window;
 
-    Array<VertexBinding> bindings = allocate_array<VertexBinding>(4, temporary_allocator());
-    bindings[0] = {VERTEX_COMPONENT_V3, ShaderPositionLocation, STRUCT_OFFSET(UITextVertex, pos)};
-    bindings[1] = {VERTEX_COMPONENT_V2, ShaderUVLocation      , STRUCT_OFFSET(UITextVertex, uv)};
-    bindings[2] = {VERTEX_COMPONENT_PACKED_COLOR, ShaderForegroundColorLocation, STRUCT_OFFSET(UITextVertex, fg)};
-    bindings[3] = {VERTEX_COMPONENT_PACKED_COLOR, ShaderBackgroundColorLocation, STRUCT_OFFSET(UITextVertex, bg)};
-
-    create_gpu_buffer(&ui->text_vertex_buffer, sizeof(UITextVertex), 0, 0, bindings);
+    // NOTE: The text shader fetches the cells from the texture buffer and builds the quads from
+    //       gl_VertexID, there are no vertex attributes. A core context still wants a vertex array bound.
+    static_assert(sizeof(UITextCell) == 16, "UITextCell must match the RGBA32UI texel of the cell buffer.");
+    create_gpu_buffer(&ui->text_vertex_buffer, 0, 0, 0, {});
 
     create_gpu_shader(&ui->text_shader, "text.glsl");
+
+    glUseProgram(ui->text_shader.id);
+    glUniform1i(glGetUniformLocation(ui->text_shader.id, "image"), 0);
+    glUniform1i(glGetUniformLocation(ui->text_shader.id, "cells"), 1);
+    ui->text_cell_size_location = glGetUniformLocation(ui->text_shader.id, "cell_size");
 }
 
 
@@ -208,6 +202,12 @@ void destroy_ui(UIState *ui) {
     destroy(ui->windows);
     destroy(ui->vertices);
     destroy(ui->widget_data);
+
+    FOR (ui->grids, grid) {
+        destroy(grid->cells);
+        destroy(grid->dirty_rows);
+    }
+    destroy(ui->grids);
 }
 
 void begin_frame(UIState *ui, V2 window_size, UserInput *input) {
@@ -219,7 +219,6 @@ void begin_frame(UIState *ui, V2 window_size, UserInput *input) {
     prepare_for_new_frame(&ui->default_window);
 
     ui->vertices.size = 0;
-    ui->text_vertices.size = 0;
 }
 
 void end_frame(UIState *ui) {
@@ -419,26 +418,139 @@ INTERNAL void draw_character(UIState *ui, V2 offset, V2i tile, u32 cp, u32 fg, u
 }
 */
 
-INTERNAL void draw_character(UIState *ui, ConsoleFont *font, V2 offset, V2i tile, u32 cp, u32 kind, u32 fg, u32 bg) {
+// A wide glyph is only drawn over the next cell if that one is free for it, which is the case when
+// the character itself takes two cells. Otherwise it is cut to the first cell.
+INTERNAL UITextCell make_text_cell(ConsoleFont *font, V2 offset, V2i tile, u32 cp, u32 kind, u32 fg, u32 bg, b32 two_cells = false) {
     ConsoleGlyphInfo *glyph = get_glyph(font, kind, cp);
 
-    r32 x0 = offset.x + tile.x * font->glyph_width;
-    r32 y0 = offset.y + tile.y * font->glyph_height;
-    r32 x1 = x0 + font->glyph_width;
-    r32 y1 = y0 + font->glyph_height;
+    UITextCell cell = {};
+    cell.x  = (u16)(offset.x + tile.x * font->glyph_width);
+    cell.y  = (u16)(offset.y + tile.y * font->glyph_height);
+    cell.atlas_x = (u16)glyph->offset_in_atlas.x | (two_cells && glyph->width > 1 ? UITextCellWide : 0);
+    cell.atlas_y = (u16)glyph->offset_in_atlas.y;
+    cell.fg = fg;
+    cell.bg = bg;
+
+    return cell;
+}
+
+r64 const CursorBlinkInterval = 0.5;
+u32 const CursorColor = PACK_RGB(255, 0, 255);
+
+INTERNAL s32 get_text_grid(UIState *ui, void *id) {
+    for (s32 i = 0; i < ui->grids.size; i += 1) {
+        if (ui->grids[i].id == id) return i;
+    }
+
+    UITextGrid grid = {};
+    grid.id = id;
+    create_gpu_texture_buffer(&grid.buffer);
+
+    append(ui->grids, grid);
+
+    return ui->grids.size - 1;
+}
+
+// The cursor stays solid for a moment after every change, so it doesn't vanish while typing.
+INTERNAL b32 cursor_blink_visible(UITextGrid *grid, r64 now) {
+    s64 phase = (s64)((now - grid->blink_start) / CursorBlinkInterval);
+
+    return phase % 2 == 0;
+}
+
+r64 ui_next_frame_time(UIState *ui) {
+    r64 now  = platform_get_time();
+    r64 next = -1;
+
+    FOR (ui->grids, grid) {
+        r64 toggle;
+        if (cursor_blink_visible(grid, now) != grid->cursor_visible) {
+            toggle = now;
+        } else {
+            s64 phase = (s64)((now - grid->blink_start) / CursorBlinkInterval);
+            toggle = grid->blink_start + (phase + 1) * CursorBlinkInterval;
+        }
+
+        if (next < 0 || toggle < next) next = toggle;
+    }
+
+    return next;
+}
+
+INTERNAL void build_grid_row(UITextGrid *grid, ConsoleBuffer *buffer, s32 row, V2i cursor) {
+    ConsoleTile *tiles = &buffer->display_buffer[row * grid->size.x];
+    UITextCell  *cells = &grid->cells[row * grid->size.x];
 
-    r32 u0 = glyph->offset_in_atlas[kind].x * FONT_ATLAS_RATIO;
-    r32 v0 = glyph->offset_in_atlas[kind].y * FONT_ATLAS_RATIO;
-    r32 u1 = (glyph->offset_in_atlas[kind].x + font->glyph_width)  * FONT_ATLAS_RATIO;
-    r32 v1 = (glyph->offset_in_atlas[kind].y + font->glyph_height) * FONT_ATLAS_RATIO;
+    for (s32 x = 0; x < grid->size.x; x += 1) {
+        ConsoleTile *tile = &tiles[x];
+        ConsoleStyle *style = get_style(buffer, tile->style);
 
-    add_text_vertex(ui, {{x0, y0}, {u0, v0}, fg, bg});
-    add_text_vertex(ui, {{x1, y0}, {u1, v0}, fg, bg});
-    add_text_vertex(ui, {{x0, y1}, {u0, v1}, fg, bg});
+        u32 bg = style->bg;
+        if (grid->cursor_visible && x == cursor.x && row == cursor.y) bg = CursorColor;
 
-    add_text_vertex(ui, {{x0, y1}, {u0, v1}, fg, bg});
-    add_text_vertex(ui, {{x1, y0}, {u1, v0}, fg, bg});
-    add_text_vertex(ui, {{x1, y1}, {u1, v1}, fg, bg});
+        // NOTE: The wide character in front already covers this cell, so it draws nothing unless the cursor is on it.
+        if (tile->cp == ConsoleWideSpacer) {
+            cells[x] = make_text_cell(buffer->font, grid->origin, {x, row}, ' ', CONSOLE_FONT_REGULAR, 0, bg == CursorColor ? bg : 0);
+            continue;
+        }
+
+        // NOTE: Empty tiles get a space, so every cell of the grid can be drawn the same way.
+        u32 cp = tile->cp ? tile->cp : ' ';
+        b32 two_cells = x + 1 < grid->size.x && tiles[x + 1].cp == ConsoleWideSpacer;
+
+        cells[x] = make_text_cell(buffer->font, grid->origin, {x, row}, cp, style->font_kind, style->fg, bg, two_cells);
+    }
+
+    grid->dirty_rows[row] = true;
+}
+
+// Puts a character of the prompt row at x and moves x past it. Wide characters take two cells
+// like they do in the console.
+INTERNAL void put_prompt_character(UITextGrid *grid, ConsoleBuffer *buffer, s32 *x, u32 cp, u32 fg, u32 bg) {
+    s32 row = grid->size.y - 1;
+    UITextCell *cells = &grid->cells[row * grid->size.x];
+
+    b32 two_cells = is_wide_character(cp) && *x + 1 < grid->size.x;
+    cells[*x] = make_text_cell(buffer->font, grid->origin, {*x, row}, cp, CONSOLE_FONT_REGULAR, fg, bg, two_cells);
+    *x += 1;
+
+    if (two_cells) {
+        cells[*x] = make_text_cell(buffer->font, grid->origin, {*x, row}, ' ', CONSOLE_FONT_REGULAR, 0, 0);
+        *x += 1;
+    }
+}
+
+INTERNAL void build_prompt_row(UITextGrid *grid, ConsoleBuffer *buffer) {
+    s32 row = grid->size.y - 1;
+    UITextCell *cells = &grid->cells[row * grid->size.x];
+
+    u32 fg = buffer->fg_color;
+    u32 bg = 0;
+
+    s32 x = 0;
+    for (s64 i = 0; i < buffer->prompt.buffer_used && x < grid->size.x; i += 1) {
+        put_prompt_character(grid, buffer, &x, buffer->prompt.buffer[i], fg, bg);
+    }
+
+    // TODO: Skip beginning if too long or add command lines at the bottom
+    s64 index = 0;
+    for (; index < buffer->command.size && x < grid->size.x; index += 1) {
+        if (index == buffer->cursor_pos) {
+            put_prompt_character(grid, buffer, &x, buffer->command[index], bg, fg);
+        } else {
+            put_prompt_character(grid, buffer, &x, buffer->command[index], fg, bg);
+        }
+    }
+    if (index == buffer->cursor_pos && x < grid->size.x) {
+        cells[x] = make_text_cell(buffer->font, grid->origin, {x, row}, ' ', CONSOLE_FONT_REGULAR, bg, fg);
+        x += 1;
+    }
+
+    for (; x < grid->size.x; x += 1) {
+        cells[x] = make_text_cell(buffer->font, grid->origin, {x, row}, ' ', CONSOLE_FONT_REGULAR, 0, 0);
+    }
+
+    grid->dirty_rows[row] = true;
 }
 
 INTERNAL void append_code_point(DArray<u8> *cmd, u32 cp) {
@@ -486,7 +598,7 @@ b32 console_buffer_view(UIState *ui, void *id, ConsoleBuffer *buffer) {
     if (tile_count.x != buffer->tile_count.x || tile_count.y != buffer->tile_count.y) {
         buffer->tile_count = tile_count;
 
-        update_lines(buffer);
+        reflow_lines(buffer);
         update_display_buffer(buffer);
     }
 
@@ -495,8 +607,6 @@ b32 console_buffer_view(UIState *ui, void *id, ConsoleBuffer *buffer) {
         return false;
     }
 
-    new_task(ui, UI_TASK_TEXT, ui->font_texture);
-
     V2 padding = {region.w - (buffer->font->glyph_width * tile_count.x), region.h - (buffer->font->glyph_height * tile_count.y)};
 
     V2 offset = {
@@ -504,33 +614,18 @@ b32 console_buffer_view(UIState *ui, void *id, ConsoleBuffer *buffer) {
         floorf(region.y + (padding.y * 0.5f))
     };
 
-    u32 fg = buffer->fg_color;
-    u32 bg = 0;
+    s32 grid_index = get_text_grid(ui, id);
+    UITextGrid *grid = &ui->grids[grid_index];
 
-    tile_count.y -= 1;
+    if (grid->size.x != tile_count.x || grid->size.y != tile_count.y || grid->origin.x != offset.x || grid->origin.y != offset.y) {
+        grid->size   = tile_count;
+        grid->origin = offset;
 
-    V2i cursor_pos = local_cursor_pos(buffer);
-
-    V2i current_tile = {};
-    FOR (buffer->display_buffer, tile) {
-        if (current_tile.x == cursor_pos.x && current_tile.y == cursor_pos.y) {
-            draw_character(ui, buffer->font, offset, current_tile, ' ', tile->style, tile->fg, PACK_RGB(255, 0, 255));
-        }
-
-        if (tile->cp != 0) {
-            draw_character(ui, buffer->font, offset, current_tile, tile->cp, tile->style, tile->fg, tile->bg);
-        }
-
-        current_tile.x += 1;
-        if (current_tile.x == buffer->tile_count.x) {
-            current_tile.y += 1;
-            current_tile.x  = 0;
-        }
+        prealloc(grid->cells, tile_count.x * tile_count.y);
+        prealloc(grid->dirty_rows, tile_count.y);
+        grid->needs_full_upload = true;
     }
 
-    current_tile.y = tile_count.y;
-    current_tile.x = 0;
-
     b32 fire_command = false;
 
     UserInput *input = &ui->input;
@@ -629,8 +724,8 @@ b32 console_buffer_view(UIState *ui, void *id, ConsoleBuffer *buffer) {
         u32 const lines_to_scroll = 3;
 
         buffer->scroll_offset += input->mouse.scroll * lines_to_scroll;
-        if (buffer->scroll_offset + buffer->tile_count.y > buffer->lines.size) {
-            buffer->scroll_offset = buffer->lines.size - buffer->tile_count.y;
+        if (buffer->scroll_offset > scrollback_line_count(buffer)) {
+            buffer->scroll_offset = scrollback_line_count(buffer);
         }
 
         if (buffer->scroll_offset < 0) buffer->scroll_offset = 0;
@@ -638,29 +733,71 @@ b32 console_buffer_view(UIState *ui, void *id, ConsoleBuffer *buffer) {
         update_display_buffer(buffer);
     }
 
-    for (s64 i = 0; i < buffer->prompt.buffer_used; i += 1) {
-        draw_character(ui, buffer->font, offset, current_tile, buffer->prompt.buffer[i], CONSOLE_FONT_REGULAR, fg, bg);
-        current_tile.x += 1;
-    }
+    r64 now = platform_get_time();
+    if (buffer->damaged || input->key_buffer_used) grid->blink_start = now;
 
-    s64 index = 0;
-    // TODO: Skip beginning if too long or add command lines at the bottom
-    for (;index < buffer->command.size; index += 1) {
-        if (index == buffer->cursor_pos) {
-            draw_character(ui, buffer->font, offset, current_tile, buffer->command[index], CONSOLE_FONT_REGULAR, bg, fg);
-        } else {
-            draw_character(ui, buffer->font, offset, current_tile, buffer->command[index], CONSOLE_FONT_REGULAR, fg, bg);
-        }
+    V2i cursor = buffer->display_cursor;
+
+    b32 cursor_visible = cursor_blink_visible(grid, now);
+    b32 blink_changed  = cursor_visible != grid->cursor_visible;
+    grid->cursor_visible = cursor_visible;
 
-        current_tile.x += 1;
+    // NOTE: The last row is the prompt, it is small enough to be rebuilt every frame.
+    for (s32 row = 0; row < grid->size.y - 1; row += 1) {
+        b32 damaged = grid->needs_full_upload || buffer->damaged_rows[row] || (blink_changed && row == cursor.y);
+        if (damaged) build_grid_row(grid, buffer, row, cursor);
     }
-    if (index == buffer->cursor_pos) {
-        draw_character(ui, buffer->font, offset, current_tile, ' ', CONSOLE_FONT_REGULAR, bg, fg);
+    build_prompt_row(grid, buffer);
+
+    // NOTE: An evicted glyph may still be on screen in a row that was not rebuilt, its atlas cell now
+    //       holds another glyph. Everything is rebuilt then. Glyphs used during this frame are pinned,
+    //       so once every glyph on screen was touched no more evictions happen.
+    while (grid->glyph_evictions != buffer->font->evictions) {
+        grid->glyph_evictions = buffer->font->evictions;
+
+        for (s32 row = 0; row < grid->size.y - 1; row += 1) {
+            build_grid_row(grid, buffer, row, cursor);
+        }
+        build_prompt_row(grid, buffer);
     }
 
+    clear_damage(buffer);
+
+    UITask task = {};
+    task.kind      = UI_TASK_TEXT_GRID;
+    task.texture   = ui->font_texture;
+    task.count     = grid->cells.size;
+    task.cell_size = {(r32)buffer->font->glyph_width, (r32)buffer->font->glyph_height};
+    task.grid      = grid_index;
+
+    append(ui->current_window->tasks, task);
+
     return fire_command;
 }
 
+INTERNAL void upload_text_grid(UITextGrid *grid) {
+    if (grid->needs_full_upload) {
+        update_gpu_texture_buffer(&grid->buffer, grid->cells.memory, grid->cells.size * sizeof(UITextCell));
+        grid->needs_full_upload = false;
+    } else {
+        // Neighbouring dirty rows are uploaded together.
+        u32 row_size = grid->size.x * sizeof(UITextCell);
+
+        for (s32 row = 0; row < grid->dirty_rows.size; row += 1) {
+            if (!grid->dirty_rows[row]) continue;
+
+            s32 first = row;
+            while (row + 1 < grid->dirty_rows.size && grid->dirty_rows[row + 1]) row += 1;
+
+            update_gpu_texture_buffer_range(&grid->buffer, first * row_size, &grid->cells[first * grid->size.x], (row - first + 1) * row_size);
+        }
+    }
+
+    FOR (grid->dirty_rows, dirty) {
+        *dirty = false;
+    }
+}
+
 INTERNAL void draw_window(Renderer *renderer, UIWindow *window) {
     FOR (window->tasks, task) {
         if (task->texture) {
@@ -669,7 +806,14 @@ INTERNAL void draw_window(Renderer *renderer, UIWindow *window) {
             glBindTexture(GL_TEXTURE_2D, 0);
         }
 
-        glDrawArrays(GL_TRIANGLES, task->offset, task->count);
+        if (task->kind == UI_TASK_TEXT_GRID) {
+            use_texture_buffer(renderer, &window->ui->grids[task->grid].buffer, 1);
+
+            glUniform2f(window->ui->text_cell_size_location, task->cell_size.x, task->cell_size.y);
+            glDrawArrays(GL_TRIANGLES, 0, task->count * 6);
+        } else {
+            glDrawArrays(GL_TRIANGLES, task->offset, task->count);
+        }
     }
 }
 
@@ -680,10 +824,12 @@ INTERNAL void draw_window(Renderer *renderer, UIWindow *window) {
 //       Can this be made a bit better?
 void draw_ui(Renderer *renderer, UIState *ui) {
     glUseProgram(ui->text_shader.id);
-    update_gpu_buffer(&ui->text_vertex_buffer, ui->text_vertices.memory, ui->text_vertices.size);
+
+    FOR (ui->grids, grid) {
+        upload_text_grid(grid);
+    }
 
     glBindVertexArray(ui->text_vertex_buffer.vao);
-    glBindBuffer(GL_ARRAY_BUFFER, ui->text_vertex_buffer.vbo);
 
     glDisable(GL_DEPTH_TEST);
     glEnable(GL_BLEND);
@@ -696,4 +842,3 @@ void draw_ui(Renderer *renderer, UIState *ui) {
     glEnable(GL_DEPTH_TEST);
     glDisable(GL_BLEND);
 }
-
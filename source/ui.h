@@ -45,14 +45,18 @@ struct UIHittest {
 
 enum UITaskKind {
     UI_TASK_REGULAR,
-    UI_TASK_TEXT,
+    UI_TASK_TEXT_GRID,
 };
 struct UITask {
     UITaskKind kind;
     GPUTexture *texture;
 
+    // Text grid tasks count cells, everything else vertices.
     s32 offset;
     s32 count;
+
+    V2 cell_size;
+    s32 grid; // Index into UIState.grids for UI_TASK_TEXT_GRID.
 };
 
 struct UIWindow {
@@ -79,13 +83,40 @@ struct UIVertex {
     V4 color;
 };
 
-struct UITextVertex {
-    V3 pos;
-    V2 uv;
+// One glyph on the screen. The text shader expands it into a quad, see text.glsl.
+struct UITextCell {
+    u16 x;
+    u16 y;
+    u16 atlas_x; // The highest bit is UITextCellWide.
+    u16 atlas_y;
     u32 fg;
     u32 bg;
 };
 
+// The glyph takes two cells of the atlas and is drawn over the next cell as well, background included.
+// Only set when the next cell belongs to the same character and draws nothing itself.
+u16 const UITextCellWide = 0x8000;
+
+// The cells of a console view. They stay on the GPU between frames, only rows the buffer
+// reports as damaged are rebuilt and uploaded again.
+struct UITextGrid {
+    void *id;
+
+    V2i size;
+    V2  origin;
+
+    DArray<UITextCell> cells;
+    DArray<b8> dirty_rows; // Changed since the last upload.
+    b32 needs_full_upload;
+
+    b32 cursor_visible;
+    r64 blink_start;
+
+    s64 glyph_evictions; // Of the font, when the cells were last built.
+
+    GPUTextureBuffer buffer;
+};
+
 struct UIPersistentData {
     void *id;
 
@@ -110,12 +141,13 @@ struct UIState {
     UIWindow  default_window;
 
     DArray<UIVertex> vertices;
-    DArray<UITextVertex> text_vertices;
 
     DArray<UIPersistentData> widget_data;
+    DArray<UITextGrid> grids;
 
     GPUBuffer text_vertex_buffer;
     GPUShader text_shader;
+    GLint text_cell_size_location;
 };
 
 
@@ -125,6 +157,10 @@ void destroy_ui(UIState *ui);
 void begin_frame(UIState *ui, V2 window_size, UserInput *input);
 void end_frame(UIState *ui);
 
+// When the next thing the UI shows changes on its own, like a blinking cursor, in platform_get_time seconds.
+// Negative if nothing does.
+r64 ui_next_frame_time(UIState *ui);
+
 void row_layout(UIState *ui, r32 height, s32 columns, UILayoutRowKind kind);
 void column_width(UIState *ui, r32 width);
 
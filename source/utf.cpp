@@ -367,6 +367,92 @@ UTF8CharResult to_utf8(u32 cp) {
     return result;
 }
 
+struct CodePointRange {
+    u32 first;
+    u32 last;
+};
+
+// Sorted, so the lookup can be a binary search.
+INTERNAL CodePointRange const WideCharacters[] = {
+    {0x1100,  0x115F},  // Hangul Jamo initial consonants
+    {0x231A,  0x231B},  // Watch, hourglass
+    {0x2329,  0x232A},  // Angle brackets
+    {0x23E9,  0x23EC},
+    {0x23F0,  0x23F0},
+    {0x23F3,  0x23F3},
+    {0x25FD,  0x25FE},
+    {0x2614,  0x2615},
+    {0x2648,  0x2653},
+    {0x267F,  0x267F},
+    {0x2693,  0x2693},
+    {0x26A1,  0x26A1},
+    {0x26AA,  0x26AB},
+    {0x26BD,  0x26BE},
+    {0x26C4,  0x26C5},
+    {0x26CE,  0x26CE},
+    {0x26D4,  0x26D4},
+    {0x26EA,  0x26EA},
+    {0x26F2,  0x26F3},
+    {0x26F5,  0x26F5},
+    {0x26FA,  0x26FA},
+    {0x26FD,  0x26FD},
+    {0x2705,  0x2705},
+    {0x270A,  0x270B},
+    {0x2728,  0x2728},
+    {0x274C,  0x274C},
+    {0x274E,  0x274E},
+    {0x2753,  0x2755},
+    {0x2757,  0x2757},
+    {0x2795,  0x2797},
+    {0x27B0,  0x27B0},
+    {0x27BF,  0x27BF},
+    {0x2B1B,  0x2B1C},
+    {0x2B50,  0x2B50},
+    {0x2B55,  0x2B55},
+    {0x2E80,  0x303E},  // CJK radicals, Kangxi, CJK symbols and punctuation
+    {0x3041,  0x33FF},  // Hiragana, Katakana, Bopomofo, Hangul compatibility, CJK compatibility
+    {0x3400,  0x4DBF},  // CJK extension A
+    {0x4E00,  0x9FFF},  // CJK unified ideographs
+    {0xA000,  0xA4CF},  // Yi
+    {0xA960,  0xA97F},  // Hangul Jamo extended A
+    {0xAC00,  0xD7A3},  // Hangul syllables
+    {0xF900,  0xFAFF},  // CJK compatibility ideographs
+    {0xFE10,  0xFE19},  // Vertical forms
+    {0xFE30,  0xFE6F},  // CJK compatibility forms, small form variants
+    {0xFF00,  0xFF60},  // Fullwidth forms
+    {0xFFE0,  0xFFE6},
+    {0x16FE0, 0x18AFF}, // Tangut
+    {0x1B000, 0x1B16F}, // Kana supplement and extensions
+    {0x1F004, 0x1F004},
+    {0x1F0CF, 0x1F0CF},
+    {0x1F18E, 0x1F18E},
+    {0x1F191, 0x1F19A},
+    {0x1F200, 0x1F251}, // Enclosed ideographic supplement
+    {0x1F300, 0x1F64F}, // Pictographs, emoticons
+    {0x1F680, 0x1F6FF}, // Transport and map symbols
+    {0x1F7E0, 0x1F7EB},
+    {0x1F90C, 0x1F9FF}, // Supplemental symbols and pictographs
+    {0x1FA70, 0x1FAFF},
+    {0x20000, 0x2FFFD}, // CJK extension B and later
+    {0x30000, 0x3FFFD},
+};
+
+b32 is_wide_character(u32 cp) {
+    if (cp < WideCharacters[0].first) return false;
+
+    s32 low  = 0;
+    s32 high = (s32)ARRAY_SIZE(WideCharacters) - 1;
+    while (low <= high) {
+        s32 middle = (low + high) / 2;
+
+        if      (cp > WideCharacters[middle].last)  low  = middle + 1;
+        else if (cp < WideCharacters[middle].first) high = middle - 1;
+        else return true;
+    }
+
+    return false;
+}
+
 
 void reset(UTF8String *string) {
     string->bytes.size = 0;
@@ -55,6 +55,9 @@ UTF8CharResult utf8_peek(String str);
 
 UTF8CharResult to_utf8(u32 cp);
 
+// East Asian wide and fullwidth characters as well as emoji take two cells in a terminal.
+b32 is_wide_character(u32 cp);
+
 
 struct CodePointInfo {
     s64 index;
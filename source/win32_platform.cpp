@@ -22,6 +22,7 @@
 #include "shellapi.h"
 #include "objbase.h"
 #include "dbghelp.h"
+#include "psapi.h"
 
 
 #ifdef OS_WINDOWS
@@ -52,6 +53,8 @@ INTERNAL void free_memory_buffer(Allocator alloc, MemoryBuffer *buffer) {
 
 INTERNAL HANDLE ProcessHandle;
 INTERNAL r64 FrequencyInSeconds;
+// Set by platform_wake_main_thread, waited on in platform_wait_for_events.
+INTERNAL HANDLE WakeEvent;
 
 PlatformConsole Console;
 
@@ -315,6 +318,9 @@ int main_main() {
     QueryPerformanceFrequency(&PerformanceFrequenzy);
     FrequencyInSeconds = 1.0 / PerformanceFrequenzy.QuadPart;
 
+    WakeEvent = CreateEvent(0, FALSE, FALSE, 0);
+    if (!WakeEvent) die("Could not create the wake up event.");
+
     PlatformFile standard_out_handle = {};
     standard_out_handle.handle = GetStdHandle(STD_OUTPUT_HANDLE);
     standard_out_handle.write_buffer = allocate_memory_buffer(DefaultAllocator, PLATFORM_CONSOLE_BUFFER_SIZE);
@@ -344,6 +350,8 @@ int main_main() {
 
     flush_write_buffer(Console.out);
 
+    CloseHandle(WakeEvent);
+
     destroy(&TemporaryStorage);
     free_memory_buffer(DefaultAllocator, &Console.out->write_buffer);
 
@@ -404,7 +412,9 @@ PlatformFile platform_create_file_handle(String filename, u32 mode) {
     } break;
 
     case PLATFORM_FILE_APPEND: {
-        win32_mode = GENERIC_READ | GENERIC_WRITE;
+        // NOTE: Without FILE_WRITE_DATA every write goes to the end, so writes of several
+        //       processes end up one after the other instead of overwriting each other.
+        win32_mode = GENERIC_READ | FILE_APPEND_DATA;
         win32_open_mode = OPEN_ALWAYS;
     } break;
 
@@ -449,6 +459,40 @@ s64 platform_file_size(PlatformFile *file) {
     return size.QuadPart;
 }
 
+PlatformMappedFile platform_map_file(String filename) {
+    PlatformMappedFile result = {};
+
+    String16 wide_filename = to_utf16(temporary_allocator(), filename, true);
+    DEFER(deallocate(temporary_allocator(), wide_filename.data, wide_filename.size * sizeof(u16)));
+
+    convert_slash_to_backslash((wchar_t*)wide_filename.data, wide_filename.size);
+
+    HANDLE handle = CreateFileW((wchar_t*)wide_filename.data, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (handle == INVALID_HANDLE_VALUE) return result;
+    DEFER(CloseHandle(handle));
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0) return result;
+
+    HANDLE mapping = CreateFileMappingW(handle, 0, PAGE_READONLY, 0, 0, 0);
+    if (mapping == 0) return result;
+    // NOTE: The view keeps the mapping alive.
+    DEFER(CloseHandle(mapping));
+
+    void *memory = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (memory == 0) return result;
+
+    result.content = {(u8*)memory, size.QuadPart};
+
+    return result;
+}
+
+void platform_unmap_file(PlatformMappedFile *file) {
+    if (file->content.data) UnmapViewOfFile(file->content.data);
+
+    INIT_STRUCT(file);
+}
+
 String platform_read(PlatformFile *file, u64 offset, void *buffer, s64 size) {
     // TODO: split reads if they are bigger than 32bit
     assert(size <= INT_MAX);
@@ -496,6 +540,17 @@ void platform_create_directory(String path) {
     CreateDirectoryW((wchar_t*)wide_path.data, 0);
 }
 
+b32 platform_rename_file(String from, String to) {
+    RESET_TEMP_STORAGE_ON_EXIT();
+
+    String16 wide_from = to_utf16(temporary_allocator(), from, true);
+    String16 wide_to   = to_utf16(temporary_allocator(), to, true);
+    convert_slash_to_backslash((wchar_t*)wide_from.data, wide_from.size);
+    convert_slash_to_backslash((wchar_t*)wide_to.data, wide_to.size);
+
+    return MoveFileExW((wchar_t*)wide_from.data, (wchar_t*)wide_to.data, MOVEFILE_REPLACE_EXISTING);
+}
+
 void platform_delete_file_or_directory(String path) {
     RESET_TEMP_STORAGE_ON_EXIT();
 
@@ -641,6 +696,15 @@ void platform_destroy_directory_listing(Array<String> *listing) {
     destroy_array(listing);
 }
 
+s64 platform_peak_memory_usage() {
+    PROCESS_MEMORY_COUNTERS counters = {};
+    counters.cb = sizeof(counters);
+
+    if (!GetProcessMemoryInfo(ProcessHandle, &counters, sizeof(counters))) return 0;
+
+    return counters.PeakWorkingSetSize;
+}
+
 void *platform_allocate_raw_memory(s64 size) {
     void *result = VirtualAlloc(0, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
     if (result == 0) show_message_box_and_crash("Could not allocate memory.");
@@ -741,6 +805,10 @@ String platform_get_executable_path() {
     return to_utf8(temporary_allocator(), {(u16*)PathBuffer, size});
 }
 
+u32 platform_process_id() {
+    return GetCurrentProcessId();
+}
+
 b32 platform_file_exists(String file) {
     String16 wide_file = to_utf16(temporary_allocator(), file, true);
     convert_slash_to_backslash((wchar_t*)wide_file.data, wide_file.size);
@@ -748,6 +816,7 @@ b32 platform_file_exists(String file) {
     return PathFileExistsW((wchar_t*)wide_file.data);
 }
 
+#ifndef HEADLESS
 /*
  * Main window creation process
  */
@@ -820,39 +889,92 @@ String platform_file_selection_dialog(String path) {
     String16 result = {(u16*)path_storage, (s64)wcslen(path_storage)};
     return to_utf8(default_allocator(), result);
 }
+#endif // HEADLESS
 
-PlatformRingBuffer platform_create_ring_buffer(s32 size) {
+INTERNAL b32 map_ring_buffer(PlatformRingBuffer *ring, s32 size) {
     SYSTEM_INFO info;
     GetSystemInfo(&info);
 
     // Set size to the next page boundry, else the mapping can not be done to the memory after the first block
     size = (size + info.dwAllocationGranularity - 1) & ~(info.dwAllocationGranularity - 1);
 
-    void *placeholder1 = VirtualAlloc2(0, 0, size * 2, MEM_RESERVE | MEM_RESERVE_PLACEHOLDER, PAGE_NOACCESS, 0, 0);
-    assert(placeholder1);
+    void *placeholder1 = VirtualAlloc2(0, 0, (SIZE_T)size * 2, MEM_RESERVE | MEM_RESERVE_PLACEHOLDER, PAGE_NOACCESS, 0, 0);
+    if (!placeholder1) return false;
 
     VirtualFree(placeholder1, size, MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER);
 
     void *placeholder2 = (u8*)placeholder1 + size;
 
     HANDLE section = CreateFileMapping(INVALID_HANDLE_VALUE, 0, PAGE_READWRITE, 0, size, 0);
-    assert(section);
+    if (!section) {
+        VirtualFree(placeholder1, 0, MEM_RELEASE);
+        VirtualFree(placeholder2, 0, MEM_RELEASE);
+
+        return false;
+    }
 
     void *view1 = MapViewOfFile3(section, 0, placeholder1, 0, size, MEM_REPLACE_PLACEHOLDER, PAGE_READWRITE, 0, 0);
-    assert(view1);
+    void *view2 = 0;
+    if (view1) view2 = MapViewOfFile3(section, 0, placeholder2, 0, size, MEM_REPLACE_PLACEHOLDER, PAGE_READWRITE, 0, 0);
+
+    if (!view1 || !view2) {
+        if (view1) UnmapViewOfFile(view1);
+        else       VirtualFree(placeholder1, 0, MEM_RELEASE);
+        VirtualFree(placeholder2, 0, MEM_RELEASE);
+        CloseHandle(section);
+
+        return false;
+    }
 
-    void *view2 = MapViewOfFile3(section, 0, placeholder2, 0, size, MEM_REPLACE_PLACEHOLDER, PAGE_READWRITE, 0, 0);
-    assert(view2);
+    INIT_STRUCT(ring);
+    ring->memory = view1;
+    ring->alloc  = size;
+    ring->platform_data = section;
+
+    return true;
+}
 
+PlatformRingBuffer platform_create_ring_buffer(s32 size) {
     PlatformRingBuffer ring = {};
-    ring.memory = view1;
-    ring.size   = 0;
-    ring.alloc  = size;
-    ring.end    = 0;
+
+    if (!map_ring_buffer(&ring, size)) die("Could not map the ring buffer.");
 
     return ring;
 }
 
+void platform_destroy_ring_buffer(PlatformRingBuffer *ring) {
+    if (!ring->memory) return;
+
+    UnmapViewOfFile((u8*)ring->memory + ring->alloc);
+    UnmapViewOfFile(ring->memory);
+    CloseHandle(ring->platform_data);
+
+    INIT_STRUCT(ring);
+}
+
+b32 platform_resize_ring_buffer(PlatformRingBuffer *ring, s32 size) {
+    PlatformRingBuffer new_ring = {};
+    if (!map_ring_buffer(&new_ring, size)) return false;
+
+    s32 keep = ring->size;
+    if (keep > new_ring.alloc) keep = new_ring.alloc;
+
+    // NOTE: Thanks to the second mapping the newest bytes are contiguous even if they wrap around.
+    u8 *src = (u8*)ring->memory + ring->end - keep;
+    if (src < (u8*)ring->memory) src += ring->alloc;
+
+    copy_memory(new_ring.memory, src, keep);
+
+    new_ring.size = keep;
+    new_ring.end  = keep;
+    if (new_ring.end == new_ring.alloc) new_ring.end = 0;
+
+    platform_destroy_ring_buffer(ring);
+    *ring = new_ring;
+
+    return true;
+}
+
 
 String platform_writable_range(PlatformRingBuffer *ring, s32 size, s32 offset) {
     if (size > ring->alloc) size = ring->alloc;
@@ -1014,7 +1136,64 @@ void platform_join_thread(PlatformThread *thread) {
     WaitForSingleObject(data->handle, INFINITE);
 }
 
-PlatformExecutionContext platform_execute(String command) {
+r64 platform_get_time() {
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+
+    return counter.QuadPart * FrequencyInSeconds;
+}
+
+void platform_sleep(s32 milliseconds) {
+    Sleep(milliseconds);
+}
+
+PlatformEvent platform_create_event() {
+    PlatformEvent event = {};
+    event.platform_data = CreateEvent(0, FALSE, FALSE, 0);
+    if (!event.platform_data) die("Could not create an event.");
+
+    return event;
+}
+
+void platform_destroy_event(PlatformEvent *event) {
+    CloseHandle(event->platform_data);
+
+    INIT_STRUCT(event);
+}
+
+void platform_signal_event(PlatformEvent *event) {
+    SetEvent(event->platform_data);
+}
+
+b32 platform_wait_event(PlatformEvent *event, s32 milliseconds) {
+    return WaitForSingleObject(event->platform_data, milliseconds) == WAIT_OBJECT_0;
+}
+
+void platform_wake_main_thread() {
+    SetEvent(WakeEvent);
+}
+
+void platform_wait_for_events(r64 deadline) {
+    DWORD timeout = INFINITE;
+    if (deadline >= 0) {
+        r64 remaining = deadline - platform_get_time();
+        if (remaining <= 0) return;
+
+        // Rounded up, waking up early would only mean another round through the loop.
+        timeout = (DWORD)(remaining * 1000.0) + 1;
+    }
+
+#ifdef HEADLESS
+    WaitForSingleObject(WakeEvent, timeout);
+#else
+    // NOTE: MWMO_INPUTAVAILABLE also returns for messages that are already queued but were
+    //       seen by an earlier PeekMessage, without it those would only be handled on the next event.
+    MsgWaitForMultipleObjectsEx(1, &WakeEvent, timeout, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+#endif // HEADLESS
+}
+
+// NOTE: The child only gets pipes and no console, so it has no size to be told about.
+PlatformExecutionContext platform_execute(String command, V2i) {
     String16 wide_command = to_utf16(temporary_allocator(), command, true);
 
     HANDLE read_pipe  = 0;
@@ -1025,60 +1204,81 @@ PlatformExecutionContext platform_execute(String command) {
     attributes.bInheritHandle       = TRUE;
     attributes.lpSecurityDescriptor = 0;
 
-    assert(CreatePipe(&read_pipe, &write_pipe, &attributes, 0));
-    assert(SetHandleInformation(read_pipe, HANDLE_FLAG_INHERIT, 0));
+    PlatformExecutionContext context = {};
+
+    if (!CreatePipe(&read_pipe, &write_pipe, &attributes, 0)) return context;
+    SetHandleInformation(read_pipe, HANDLE_FLAG_INHERIT, 0);
+
+    HANDLE input_read  = 0;
+    HANDLE input_write = 0;
+    if (!CreatePipe(&input_read, &input_write, &attributes, 0)) {
+        CloseHandle(read_pipe);
+        CloseHandle(write_pipe);
+
+        return context;
+    }
+    SetHandleInformation(input_write, HANDLE_FLAG_INHERIT, 0);
+
+    // NOTE: Writes return right away when the pipe is full, so a child that reads no input
+    //       can not freeze the window. See platform_write_input.
+    DWORD input_mode = PIPE_NOWAIT;
+    SetNamedPipeHandleState(input_write, &input_mode, 0, 0);
 
     PROCESS_INFORMATION process = {};
     STARTUPINFO info = {};
     info.cb         = sizeof(info);
+    info.hStdInput  = input_read;
     info.hStdError  = write_pipe;
     info.hStdOutput = write_pipe;
     info.dwFlags   |= STARTF_USESTDHANDLES;
 
-    PlatformExecutionContext context = {};
     BOOL status = CreateProcessW(0, (wchar_t*)wide_command.data, 0, 0, TRUE, 0, 0, 0, &info, &process);
     if (!status) {
         CloseHandle(read_pipe);
         CloseHandle(write_pipe);
+        CloseHandle(input_read);
+        CloseHandle(input_write);
 
         return context;
     }
 
     context.read_pipe      = read_pipe;
+    context.write_pipe     = input_write;
     context.thread_handle  = process.hThread;
     context.process_handle = process.hProcess;
     context.started_successfully = true;
 
     CloseHandle(write_pipe);
+    CloseHandle(input_read);
 
     return context;
 }
 
 b32 platform_finished_execution(PlatformExecutionContext *pec) {
-    if (WaitForSingleObject(pec->process_handle, 0) != WAIT_TIMEOUT) {
-        CloseHandle(pec->process_handle);
-        CloseHandle(pec->thread_handle);
-        CloseHandle(pec->read_pipe);
+    return WaitForSingleObject(pec->process_handle, 0) != WAIT_TIMEOUT;
+}
 
-        return true;
-    }
+void platform_close_execution(PlatformExecutionContext *pec) {
+    CloseHandle(pec->process_handle);
+    CloseHandle(pec->thread_handle);
+    CloseHandle(pec->read_pipe);
+    CloseHandle(pec->write_pipe);
 
-    return false;
+    INIT_STRUCT(pec);
+}
+
+// NOTE: Nothing to do, see platform_execute.
+void platform_resize_execution(PlatformExecutionContext *, V2i) {
 }
 
 u32 platform_input_available(PlatformExecutionContext *pec) {
     DWORD available = 0;
     if (!PeekNamedPipe(pec->read_pipe, 0, 0, 0, &available, 0)) {
         DWORD error = GetLastError();
-        // NOTE: Mentioned in the "Pipes" section of the ReadFile documentation.
-        if (error == ERROR_BROKEN_PIPE) {
-            CloseHandle(pec->read_pipe);
-            CloseHandle(pec->thread_handle);
-            CloseHandle(pec->process_handle);
-
-            pec->started_successfully = false;
-        } else {
-            print("platform_input_pending: Error code %d\n", GetLastError());
+        // NOTE: Mentioned in the "Pipes" section of the ReadFile documentation. The handles are
+        //       left to platform_close_execution.
+        if (error != ERROR_BROKEN_PIPE) {
+            print("platform_input_available: Error code %d\n", error);
         }
     }
 
@@ -1087,18 +1287,40 @@ u32 platform_input_available(PlatformExecutionContext *pec) {
 
 s32 platform_read(PlatformExecutionContext *pec, void *buffer, s32 size) {
     DWORD bytes_read = 0;
+    // NOTE: Fails with ERROR_BROKEN_PIPE once the child closed its end, bytes_read stays 0 then.
     ReadFile(pec->read_pipe, buffer, size, &bytes_read, 0);
 
     return bytes_read;
 }
 
+b32 platform_write_input(PlatformExecutionContext *pec, void const *buffer, s32 size) {
+    r64 deadline = platform_get_time() + 1.0;
 
+    s32 written = 0;
+    while (written < size) {
+        DWORD bytes_written = 0;
+        if (!WriteFile(pec->write_pipe, (u8*)buffer + written, size - written, &bytes_written, 0)) return false;
 
+        written += bytes_written;
+        if (bytes_written == 0) {
+            if (platform_get_time() > deadline) return false;
+
+            Sleep(1);
+        }
+    }
+
+    return true;
+}
+
+
+
+#ifndef HEADLESS
 INTERNAL V2  CurrentMousePosition;
 INTERNAL s32 CurrentMouseScroll;
 
 INTERNAL r32 WindowWidth;
 INTERNAL r32 WindowHeight;
+INTERNAL b32 WindowExposed;
 
 INTERNAL b32 AltHeld;
 INTERNAL b32 CtrlHeld;
@@ -1108,6 +1330,7 @@ INTERNAL KeyPress KeyBuffer[KeyBufferSize];
 INTERNAL s32 KeyBufferUsed;
 void platform_update(ApplicationState *state) {
     state->window_size_changed = false;
+    state->window_exposed      = false;
 
     MSG msg;
     while (PeekMessage(&msg, 0, 0, 0, PM_REMOVE)) {
@@ -1134,6 +1357,9 @@ void platform_update(ApplicationState *state) {
     state->user_input.key_buffer_used = KeyBufferUsed;
     KeyBufferUsed = 0;
 
+    state->window_exposed = WindowExposed;
+    WindowExposed = false;
+
     if (state->window_size.width != WindowWidth || state->window_size.height != WindowHeight) {
         state->window_size.width  = WindowWidth;
         state->window_size.height = WindowHeight;
@@ -1165,6 +1391,11 @@ LRESULT CALLBACK main_window_callback(HWND handle, UINT msg, WPARAM w_param, LPA
         WindowHeight = HIWORD(l_param);
     } break;
 
+    // NOTE: DefWindowProc validates the region, the frame itself is drawn by the main loop.
+    case WM_PAINT: {
+        WindowExposed = true;
+    } break;
+
     case WM_KEYDOWN: {
         if (w_param == VK_MENU) {
             AltHeld = true;
@@ -1221,4 +1452,4 @@ LRESULT CALLBACK main_window_callback(HWND handle, UINT msg, WPARAM w_param, LPA
 
     return DefWindowProc(handle, msg, w_param, l_param);
 }
-
+#endif // HEADLESS